@@ -8,8 +8,7 @@
 #include "mvs\mvs.h"
 #include "view\mvsviewer.h"
 #include "mvs\featuremanager.h"
-
-#define CONFIG_FILE_NAME "config.txt"
+#include "config.h"
 
 using namespace cv;
 using namespace PAIS;
@@ -23,34 +22,6 @@ void addPatchView(const Patch &pth) {
 	}
 }
 
-void setInitConfig() {
-	config.cellSize                 = 4;
-	config.patchRadius              = 15;
-	config.reduceNormalRange        = 2;
-	config.adaptiveDistanceEnable   = true;
-	config.adaptiveDifferenceEnable = true;
-	config.adaptiveGradientEnable   = false;
-	config.distWeighting            = config.patchRadius / 3.0;
-	config.diffWeighting            = 128*128;
-	config.gradientWeighting        = 10.0;
-	config.minCamNum                = 3;
-	config.textureVariation         = 36;
-	config.visibleCorrelation       = 0.7;
-	config.minCorrelation           = 0.7;
-	config.maxFitness               = 10.0;
-	config.minLOD                   = 0;
-	config.maxLOD                   = 15;
-	config.lodRatio                 = 0.8;
-	config.maxCellPatchNum          = 3;
-	config.neighborRadius           = 0.005;
-	config.neighborRadiusScalar     = 0.0025;
-	config.minRegionRatio           = 0.55;
-	config.depthRangeScalar         = 1;
-	config.particleNum              = 5;
-	config.maxIteration             = 10;
-	config.expansionStrategy        = MVS::EXPANSION_BEST_FIRST;
-}
-
 void runViewer(MVS &mvs, const char *fileName) {
 	mvs.loadMVS(fileName);
 
@@ -109,6 +80,8 @@ void runReconstruct(MVS &mvs, const char *fileName) {
 	mvs.refineSeedPatches();
 	mvs.writeMVS("seed.mvs"); // after optimization and runtime filtering
 	mvs.expansionPatches();
+	mvs.printSolverStatistics();
+	TaskPool::printStatistics();
 	mvs.writeMVS("exp.mvs");
 	mvs.writePLY("exp.ply");
 	mvs.writePSR("exp.psr");
@@ -171,10 +144,208 @@ void runFiltering(MVS &mvs, const char *fileName) {
 	//system("pause");
 }
 
+void runPrecision(MVS &mvs, const char *fileName) {
+	mvs.loadMVS(fileName);
+
+	// load config
+	FileLoader::loadConfig(CONFIG_FILE_NAME, config);
+	mvs.setConfig(config);
+
+	// evaluate patches in double and single precision
+	const PatchMap &patches = mvs.getPatches();
+	PatchMap::const_iterator it;
+	double p[3];
+	double fitD, fitF, diff;
+	double maxDiff = 0, sumDiff = 0, sumFit = 0;
+	int count = 0;
+	clock_t timeD = 0, timeF = 0, start_t;
+	for (it = patches.begin(); it != patches.end(); ++it) {
+		const Patch &pth = *it;
+		p[0] = pth.getSphericalNormal()[0];
+		p[1] = pth.getSphericalNormal()[1];
+		p[2] = pth.getDepth();
+
+		start_t = clock();
+		fitD = getFitness(p, (void *) &pth, false);
+		timeD += clock() - start_t;
+
+		start_t = clock();
+		fitF = getFitness(p, (void *) &pth, true);
+		timeF += clock() - start_t;
+
+		// skip invalid patch
+		if (fitD == DBL_MAX || fitF == DBL_MAX) continue;
+
+		diff     = abs(fitD - fitF);
+		maxDiff  = max(maxDiff, diff);
+		sumDiff += diff;
+		sumFit  += fitD;
+		++count;
+	}
+
+	if (count == 0) {
+		printf("no valid patch\n");
+		return;
+	}
+
+	printf("patches: %d\n", count);
+	printf("max abs diff:\t%e\n", maxDiff);
+	printf("mean abs diff:\t%e\n", sumDiff / count);
+	printf("mean rel diff:\t%e\n", sumDiff / sumFit);
+	printf("double time:\t%f\n", (double) timeD / CLOCKS_PER_SEC);
+	printf("single time:\t%f\n", (double) timeF / CLOCKS_PER_SEC);
+	LogManager::log("precision patches: %d max abs diff: %e mean abs diff: %e mean rel diff: %e", count, maxDiff, sumDiff / count, sumDiff / sumFit);
+	LogManager::log("precision time double: %f single: %f", (double) timeD / CLOCKS_PER_SEC, (double) timeF / CLOCKS_PER_SEC);
+}
+
+void runExpBenchmark(MVS &mvs, const char *countStr) {
+	const int count = max(atoi(countStr), 1);
+	const double diffWeighting = mvs.getDifferenceWeight();
+
+	// average SAD samples in [0, 128]
+	vector<double> avgSad(count);
+	srand(0);
+	for (int i = 0; i < count; ++i) {
+		avgSad[i] = 128.0 * rand() / RAND_MAX;
+	}
+
+	// exp() difference weighting
+	clock_t start_t = clock();
+	double sumExp = 0;
+	for (int i = 0; i < count; ++i) {
+		sumExp += exp(-avgSad[i]*avgSad[i]/diffWeighting);
+	}
+	const clock_t timeExp = clock() - start_t;
+
+	// table difference weighting
+	start_t = clock();
+	double sumTable = 0;
+	for (int i = 0; i < count; ++i) {
+		sumTable += mvs.getDifferenceWeighting(avgSad[i]);
+	}
+	const clock_t timeTable = clock() - start_t;
+
+	// table error
+	double maxDiff = 0;
+	for (int i = 0; i < count; ++i) {
+		maxDiff = max(maxDiff, abs(exp(-avgSad[i]*avgSad[i]/diffWeighting) - mvs.getDifferenceWeighting(avgSad[i])));
+	}
+
+	const double nsExp   = 1e9 * timeExp   / CLOCKS_PER_SEC / count;
+	const double nsTable = 1e9 * timeTable / CLOCKS_PER_SEC / count;
+	printf("samples:\t%d (checksum %f %f)\n", count, sumExp, sumTable);
+	printf("exp time:\t%f ns\n", nsExp);
+	printf("table time:\t%f ns\n", nsTable);
+	printf("max abs diff:\t%e\n", maxDiff);
+	LogManager::log("exp benchmark samples: %d exp: %f ns table: %f ns max abs diff: %e", count, nsExp, nsTable, maxDiff);
+}
+
+// refinement statistics of loaded patches (each patch refined as a copy)
+struct RefineStatistics {
+	int total;            // refined patches
+	int drop;             // dropped patches
+	double evalPerPatch;  // fitness evaluations per patch
+	double meanCorr;      // mean correlation of kept patches
+	double meanFit;       // mean fitness of kept patches
+	double sec;           // refinement time
+};
+
+// re-refine copies of loaded patches under current config (false: no patch)
+bool refineStatistics(const PatchMap &patches, RefineStatistics &stat) {
+	PatchMap::const_iterator it;
+	long long evaluations = 0;
+	double sumCorr = 0, sumFit = 0;
+	int count = 0, drop = 0;
+	const clock_t start_t = clock();
+	for (it = patches.begin(); it != patches.end(); ++it) {
+		Patch pth = *it;
+		pth.refine();
+		evaluations += pth.getEvaluations();
+
+		// skip dropped patch
+		if ( pth.isDropped() ) {
+			++drop;
+			continue;
+		}
+		sumCorr += pth.getCorrelation();
+		sumFit  += pth.getFitness();
+		++count;
+	}
+	stat.sec = (double) (clock() - start_t) / CLOCKS_PER_SEC;
+
+	stat.total = count + drop;
+	stat.drop  = drop;
+	if (stat.total == 0) {
+		printf("no patch\n");
+		return false;
+	}
+	stat.evalPerPatch = (double) evaluations / stat.total;
+	stat.meanCorr     = (count > 0) ? sumCorr / count : 0.0;
+	stat.meanFit      = (count > 0) ? sumFit  / count : 0.0;
+	return true;
+}
+
+void runOptimizerBenchmark(MVS &mvs, const char *fileName) {
+	mvs.loadMVS(fileName);
+
+	// load config
+	FileLoader::loadConfig(CONFIG_FILE_NAME, config);
+
+	// re-refine the same loaded patches by each optimization backend
+	const int backends[] = {MVS::OPTIMIZER_PSO, MVS::OPTIMIZER_SIMPLEX, MVS::OPTIMIZER_PSO_SIMPLEX, MVS::OPTIMIZER_GAUSS_NEWTON, MVS::OPTIMIZER_PSO_GAUSS_NEWTON};
+	const char *names[]  = {"pso", "simplex", "pso+simplex", "gauss-newton", "pso+gauss-newton"};
+	RefineStatistics stat;
+	for (int b = 0; b < 5; ++b) {
+		config.optimizer = backends[b];
+		mvs.setConfig(config);
+		PsoSolver<3>::clearStopCount();
+		FitnessKernel::clearPixelCount();
+
+		if ( !refineStatistics(mvs.getPatches(), stat) ) return;
+		printf("%s\tpatches: %d dropped: %d\n", names[b], stat.total, stat.drop);
+		printf("%s\tevaluations per patch:\t%f\n", names[b], stat.evalPerPatch);
+		printf("%s\tmean correlation:\t%f\n", names[b], stat.meanCorr);
+		printf("%s\tmean fitness:\t%f\n", names[b], stat.meanFit);
+		printf("%s\ttime:\t%f\n", names[b], stat.sec);
+		LogManager::log("optimizer %s patches: %d dropped: %d evaluations per patch: %f mean correlation: %f mean fitness: %f time: %f", names[b], stat.total, stat.drop, stat.evalPerPatch, stat.meanCorr, stat.meanFit, stat.sec);
+		if (backends[b] != MVS::OPTIMIZER_SIMPLEX && backends[b] != MVS::OPTIMIZER_GAUSS_NEWTON) {
+			mvs.printSolverStatistics();
+		}
+	}
+}
+
+void runInitBenchmark(MVS &mvs, const char *fileName) {
+	mvs.loadMVS(fileName);
+
+	// load config
+	FileLoader::loadConfig(CONFIG_FILE_NAME, config);
+	config.optimizer = MVS::OPTIMIZER_PSO;
+
+	// re-refine the same loaded patches by each initialization under growing evaluation budget
+	// (budget: multiple of particle number, 0: unlimited)
+	const int modes[]   = {MVS::SWARM_INIT_RANDOM, MVS::SWARM_INIT_HALTON};
+	const char *names[] = {"random", "halton"};
+	const int budgets[] = {1, 2, 4, 8, 0};
+	RefineStatistics stat;
+	for (int m = 0; m < 2; ++m) {
+		for (int b = 0; b < 5; ++b) {
+			config.swarmInit        = modes[m];
+			config.evaluationBudget = budgets[b] * config.particleNum;
+			mvs.setConfig(config);
+
+			if ( !refineStatistics(mvs.getPatches(), stat) ) return;
+			printf("%s\tbudget: %d\tevaluations per patch: %f\tmean fitness: %f\tmean correlation: %f\tdropped: %d / %d\ttime: %f\n",
+				names[m], config.evaluationBudget, stat.evalPerPatch, stat.meanFit, stat.meanCorr, stat.drop, stat.total, stat.sec);
+			LogManager::log("init %s budget: %d evaluations per patch: %f mean fitness: %f mean correlation: %f dropped: %d patches: %d time: %f",
+				names[m], config.evaluationBudget, stat.evalPerPatch, stat.meanFit, stat.meanCorr, stat.drop, stat.total, stat.sec);
+		}
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	// MVS configures
-	setInitConfig();
+	setInitConfig(config);
 	FileLoader::loadConfig(CONFIG_FILE_NAME, config);
 
 	// set MVS instance
@@ -189,9 +360,17 @@ int main(int argc, char* argv[])
 			runReconstruct(mvs, argv[2]);
 		} else if ( strcmp(argv[1], "-f") == 0 ) {  // filtering
 			runFiltering(mvs, argv[2]);
+		} else if ( strcmp(argv[1], "-p") == 0 ) {  // fitness precision
+			runPrecision(mvs, argv[2]);
+		} else if ( strcmp(argv[1], "-e") == 0 ) {  // difference weighting benchmark
+			runExpBenchmark(mvs, argv[2]);
+		} else if ( strcmp(argv[1], "-o") == 0 ) {  // optimizer benchmark
+			runOptimizerBenchmark(mvs, argv[2]);
+		} else if ( strcmp(argv[1], "-i") == 0 ) {  // swarm initialization benchmark
+			runInitBenchmark(mvs, argv[2]);
 		}
 	} else {
-		char *msg = "-v [filename.mvs]: viewer\n-a [filename.mvs]: animate\n-r {[filename.mvs], [filename.nvm], [filename.nvm2]}: reconstruction\n-f [filename.mvs]";
+		char *msg = "-v [filename.mvs]: viewer\n-a [filename.mvs]: animate\n-r {[filename.mvs], [filename.nvm], [filename.nvm2]}: reconstruction\n-f [filename.mvs]: filtering\n-p [filename.mvs]: fitness precision (double vs single)\n-e [sample number]: difference weighting benchmark (exp vs table)\n-o [filename.mvs]: optimizer benchmark (pso, simplex, gauss-newton and polish)\n-i [filename.mvs]: swarm initialization benchmark (random vs halton)\n";
 		printf(msg);
 		return 1;
 	}
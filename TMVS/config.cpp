@@ -0,0 +1,44 @@
+#include "config.h"
+
+void setInitConfig(MvsConfig &config) {
+	config.cellSize                 = 4;
+	config.patchRadius              = 15;
+	config.reduceNormalRange        = 2;
+	config.adaptiveDistanceEnable   = true;
+	config.adaptiveDifferenceEnable = true;
+	config.adaptiveGradientEnable   = false;
+	config.distWeighting            = config.patchRadius / 3.0;
+	config.diffWeighting            = 128*128;
+	config.gradientWeighting        = 10.0;
+	config.minCamNum                = 3;
+	config.textureVariation         = 36;
+	config.visibleCorrelation       = 0.7;
+	config.minCorrelation           = 0.7;
+	config.maxFitness               = 10.0;
+	config.minLOD                   = 0;
+	config.maxLOD                   = 15;
+	config.lodRatio                 = 0.8;
+	config.maxCellPatchNum          = 3;
+	config.neighborRadius           = 0.005;
+	config.neighborRadiusScalar     = 0.0025;
+	config.minRegionRatio           = 0.55;
+	config.depthRangeScalar         = 1;
+	config.particleNum              = 5;
+	config.maxIteration             = 10;
+	config.expansionStrategy        = MVS::EXPANSION_BEST_FIRST;
+	config.singlePrecisionEnable    = false;
+	config.normalQuantum            = 0.0;
+	config.depthQuantum             = 0.0;
+	config.randomSeed               = 0;
+	config.optimizer                = MVS::OPTIMIZER_PSO;
+	config.warmStartEnable          = false;
+	config.lockstepEnable           = false;
+	config.relativeThreshold        = 0.0;
+	config.stagnationIteration      = 0;
+	config.evaluationBudget         = 0;
+	config.swarmInit                = MVS::SWARM_INIT_RANDOM;
+	config.expansionBatch           = 0;
+	config.threadNum                = 0;
+	config.threadAffinity           = false;
+	config.subtaskEnable            = true;
+}
\ No newline at end of file
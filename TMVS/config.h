@@ -0,0 +1,13 @@
+#ifndef __PAIS_CONFIG_H__
+#define __PAIS_CONFIG_H__
+
+#include "mvs/mvs.h"
+
+#define CONFIG_FILE_NAME "config.txt"
+
+using namespace PAIS;
+
+// default MVS configures (overwritten by config file)
+void setInitConfig(MvsConfig &config);
+
+#endif
\ No newline at end of file
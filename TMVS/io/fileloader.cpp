@@ -1,5 +1,7 @@
 #define STRING_BUFFER_LENGTH 10240
 #define DELIMITER " \t"
+// MVS_V3 config ends at expansion strategy (padded to double alignment)
+#define MVS_V3_CONFIG_SIZE ((int) ((offsetof(MvsConfig, singlePrecisionEnable) + sizeof(double) - 1) / sizeof(double) * sizeof(double)))
 
 #include "fileloader.h"
 
@@ -164,9 +166,13 @@ Patch FileLoader::loadNvmPatch(ifstream &file, const MVS &mvs) {
 	return Patch(center, color, camIdx, imgPoint);
 }
 
-MvsConfig FileLoader::loadMvsConfig(ifstream &file) {
-	MvsConfig config;
-	file.read((char*) &config, sizeof(MvsConfig));
+MvsConfig FileLoader::loadMvsConfig(ifstream &file, const int size, const MvsConfig &base) {
+	// fields not stored in file keep current value
+	MvsConfig config = base;
+	const int readSize = min(size, (int) sizeof(MvsConfig));
+	file.read((char*) &config, readSize);
+	// skip fields from newer version
+	file.seekg(size - readSize, ios_base::cur);
 	return config;
 }
 
@@ -250,7 +256,7 @@ void FileLoader::loadMvsVec(ifstream &file, Vec4d &v) {
 
 void FileLoader::loadNVM(const char *fileName, MVS &mvs) {
 	vector<Camera>  &cameras = mvs.cameras;
-	map<int, Patch> &patches = mvs.patches;
+	PatchMap &patches = mvs.patches;
 
 	// reset container
 	cameras.clear();
@@ -312,7 +318,7 @@ void FileLoader::loadNVM(const char *fileName, MVS &mvs) {
 			for (int i = 0; i < num; i++) {
 				printf("\rloading patches: %d / %d", i+1, num);
 				Patch p = loadNvmPatch(file, mvs);
-				patches.insert( pair<int, Patch>(p.getId(), p) );
+				patches.insert(p);
 			}
 			printf("\n");
 			loadPatch = false;
@@ -326,7 +332,7 @@ void FileLoader::loadNVM(const char *fileName, MVS &mvs) {
 
 void FileLoader::loadNVM2(const char *fileName, MVS &mvs) {
 	vector<Camera>  &cameras = mvs.cameras;
-	map<int, Patch> &patches = mvs.patches;
+	PatchMap &patches = mvs.patches;
 
 	// reset container
 	cameras.clear();
@@ -388,7 +394,7 @@ void FileLoader::loadNVM2(const char *fileName, MVS &mvs) {
 			for (int i = 0; i < num; i++) {
 				printf("\rloading patches: %d / %d", i+1, num);
 				Patch p = loadNvmPatch(file, mvs);
-				patches.insert( pair<int, Patch>(p.getId(), p) );
+				patches.insert(p);
 			}
 			printf("\n");
 			loadPatch = false;
@@ -402,7 +408,7 @@ void FileLoader::loadNVM2(const char *fileName, MVS &mvs) {
 
 void FileLoader::loadMVS(const char *fileName, MVS &mvs) {
 	vector<Camera>  &cameras = mvs.cameras;
-	map<int, Patch> &patches = mvs.patches;
+	PatchMap &patches = mvs.patches;
 
 	// reset container
 	cameras.clear();
@@ -436,7 +442,16 @@ void FileLoader::loadMVS(const char *fileName, MVS &mvs) {
 
 		// set config and start load camera
 		if (strcmp(strip, "MVS_V3") == 0) {
-			MvsConfig config = loadMvsConfig(file);
+			MvsConfig config = loadMvsConfig(file, MVS_V3_CONFIG_SIZE, mvs);
+			mvs.setConfig(config);
+			loadCamera = true;
+			continue;
+		}
+
+		// set config (with config size) and start load camera
+		if (strcmp(strip, "MVS_V4") == 0) {
+			strip = strtok(NULL, DELIMITER);
+			MvsConfig config = loadMvsConfig(file, atoi(strip), mvs);
 			mvs.setConfig(config);
 			loadCamera = true;
 			continue;
@@ -461,7 +476,7 @@ void FileLoader::loadMVS(const char *fileName, MVS &mvs) {
 			for (int i = 0; i < num; ++i) {
 				printf("\rloading patches: %d / %d", i+1, num);
 				Patch pth = loadMvsPatch(file);
-				patches.insert( pair<int, Patch>(pth.getId(), pth) );
+				patches.insert(pth);
 			}
 			printf("\n");
 			loadPatch = false;
@@ -557,6 +572,51 @@ void FileLoader::loadConfig(const char *fileName, MvsConfig &config) {
 		} else if ( strcmp(strip, "neighborRadiusScalar") == 0 ) {
 			strip = strtok(NULL, " \t");
 			config.neighborRadiusScalar = atof(strip);
+		} else if ( strcmp(strip, "singlePrecisionEnable") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.singlePrecisionEnable = atoi(strip);
+		} else if ( strcmp(strip, "normalQuantum") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.normalQuantum = atof(strip);
+		} else if ( strcmp(strip, "depthQuantum") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.depthQuantum = atof(strip);
+		} else if ( strcmp(strip, "randomSeed") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.randomSeed = atoi(strip);
+		} else if ( strcmp(strip, "optimizer") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.optimizer = atoi(strip);
+		} else if ( strcmp(strip, "warmStartEnable") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.warmStartEnable = atoi(strip);
+		} else if ( strcmp(strip, "lockstepEnable") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.lockstepEnable = atoi(strip);
+		} else if ( strcmp(strip, "relativeThreshold") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.relativeThreshold = atof(strip);
+		} else if ( strcmp(strip, "stagnationIteration") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.stagnationIteration = atoi(strip);
+		} else if ( strcmp(strip, "evaluationBudget") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.evaluationBudget = atoi(strip);
+		} else if ( strcmp(strip, "swarmInit") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.swarmInit = atoi(strip);
+		} else if ( strcmp(strip, "expansionBatch") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.expansionBatch = atoi(strip);
+		} else if ( strcmp(strip, "threadNum") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.threadNum = atoi(strip);
+		} else if ( strcmp(strip, "threadAffinity") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.threadAffinity = atoi(strip);
+		} else if ( strcmp(strip, "subtaskEnable") == 0 ) {
+			strip = strtok(NULL, " \t");
+			config.subtaskEnable = atoi(strip);
 		}
 	}
 
@@ -570,3 +630,7 @@ void FileLoader::loadConfig(const char *fileName, MvsConfig &config) {
 #ifdef DELIMITER
 	#undef DELIMITER
 #endif
+
+#ifdef MVS_V3_CONFIG_SIZE
+	#undef MVS_V3_CONFIG_SIZE
+#endif
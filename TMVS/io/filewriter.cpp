@@ -75,8 +75,8 @@ void FileWriter::writeMVS(const char *fileName, const MVS &mvs) {
 		printf("Can't write file %s\n", fileName);
 	}
 
-	// write MVS header
-	file << "MVS_V3" << endl;
+	// write MVS header (with config size)
+	file << "MVS_V4 " << sizeof(MvsConfig) << endl;
 
 	// write MVS config
 	writeMvsConfig(file, mvs);
@@ -90,20 +90,20 @@ void FileWriter::writeMVS(const char *fileName, const MVS &mvs) {
 	}
 
 	// write patches
-	const map<int, Patch> &patches = mvs.getPatches();
+	const PatchMap &patches = mvs.getPatches();
 	const int patchNum = (int) patches.size();
 	file << "PATCHES " << patchNum << endl;
-	map<int, Patch>::const_iterator it;
+	PatchMap::const_iterator it;
 	for (it = patches.begin(); it != patches.end(); ++it) {
-		writePatch(file, (*it).second);
+		writePatch(file, *it);
 	}
 
 	file.close();
 }
 
 void FileWriter::writePLY(const char *fileName, const MVS &mvs) {
-	const map<int, Patch> &patches = mvs.getPatches();
-	map<int, Patch>::const_iterator it;
+	const PatchMap &patches = mvs.getPatches();
+	PatchMap::const_iterator it;
 	ofstream file;
 	file.open(fileName, ofstream::out);
 	if ( !file.is_open() ) {
@@ -126,7 +126,7 @@ void FileWriter::writePLY(const char *fileName, const MVS &mvs) {
 	file << "end_header"                   << endl;
 
 	for (it = patches.begin(); it != patches.end(); ++it) {
-		const Patch &pth = it->second;
+		const Patch &pth = *it;
 		const Vec3d &p   = pth.getCenter();
 		const Vec3d &n   = pth.getNormal();
 		const Vec3b &c   = pth.getColor();
@@ -139,8 +139,8 @@ void FileWriter::writePLY(const char *fileName, const MVS &mvs) {
 }
 
 void FileWriter::wirtePSR(const char *fileName, const MVS &mvs) {
-	const map<int, Patch> &patches = mvs.getPatches();
-	map<int, Patch>::const_iterator it;
+	const PatchMap &patches = mvs.getPatches();
+	PatchMap::const_iterator it;
 	ofstream file;
 	file.open(fileName, ofstream::binary);
 	if ( !file.is_open() ) {
@@ -149,7 +149,7 @@ void FileWriter::wirtePSR(const char *fileName, const MVS &mvs) {
 	}
 
 	for (it = patches.begin(); it != patches.end(); ++it) {
-		const Patch &pth = it->second;
+		const Patch &pth = *it;
 		const Vec3d &p   = pth.getCenter();
 		const Vec3d &n   = pth.getNormal();
 		float num;
@@ -177,8 +177,8 @@ void FileWriter::writeDeletedPatchMVS(const char *fileName, const MVS &mvs) {
 		printf("Can't write file %s\n", fileName);
 	}
 
-	// write MVS header
-	file << "MVS_V3" << endl;
+	// write MVS header (with config size)
+	file << "MVS_V4 " << sizeof(MvsConfig) << endl;
 
 	// write MVS config
 	writeMvsConfig(file, mvs);
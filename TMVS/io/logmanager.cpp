@@ -14,8 +14,6 @@ bool LogManager::create() {
 }
 
 void LogManager::log(const char *message, ...) {
-	if ( !create() ) return;
-
     // put formatted string
 	va_list argptr;
     va_start(argptr, message);
@@ -23,12 +21,14 @@ void LogManager::log(const char *message, ...) {
 	vsnprintf (buffer, STRING_BUFFER_LENGTH-1, message, argptr);
 	va_end(argptr);
 
-	(*instance) << "[Log]     " << buffer << endl;
+	// one writer at a time (patches are refined concurrently)
+	#pragma omp critical (LogManager)
+	{
+		if ( create() ) (*instance) << "[Log]     " << buffer << endl;
+	}
 }
 
 void LogManager::warning(const char *message, ...) {
-	if ( !create() ) return;
-
     // put formatted string
 	va_list argptr;
     va_start(argptr, message);
@@ -36,12 +36,14 @@ void LogManager::warning(const char *message, ...) {
 	vsnprintf (buffer, STRING_BUFFER_LENGTH-1, message, argptr);
 	va_end(argptr);
 
-	(*instance) << "[Warning] " << buffer << endl;
+	// one writer at a time (patches are refined concurrently)
+	#pragma omp critical (LogManager)
+	{
+		if ( create() ) (*instance) << "[Warning] " << buffer << endl;
+	}
 }
 
 void LogManager::error(const char *message, ...) {
-	if ( !create() ) return;
-
     // put formatted string
 	va_list argptr;
     va_start(argptr, message);
@@ -49,7 +51,11 @@ void LogManager::error(const char *message, ...) {
 	vsnprintf (buffer, STRING_BUFFER_LENGTH-1, message, argptr);
 	va_end(argptr);
 
-	(*instance) << "[Error]   " << buffer << endl;
+	// one writer at a time (patches are refined concurrently)
+	#pragma omp critical (LogManager)
+	{
+		if ( create() ) (*instance) << "[Error]   " << buffer << endl;
+	}
 }
 
 void LogManager::close() {
@@ -94,7 +94,7 @@ void FeatureManager::setSeedPatches(const vector<Camera> &cameras, const double
 		}
 		Patch pth(Vec3d(0, 0, 0), Vec3b(128, 128, 128), camIdx, imgPoint);
 		pth.reCentering();
-		mvs->patches.insert(pair<int, Patch>(pth.getId(), pth));
+		mvs->patches.insert(pth);
 	}
 
 	return;
@@ -0,0 +1,176 @@
+#include "fitnesskernel.h"
+#include "warpkernel.h"
+#include "mvs.h"
+
+using namespace PAIS;
+
+FitnessKernel::KernelFunc  FitnessKernel::kernelFunc  = NULL;
+FitnessKernel::KernelFuncF FitnessKernel::kernelFuncF = NULL;
+int FitnessKernel::kernelRadius = 0;
+long long FitnessKernel::pixelCount     = 0;
+long long FitnessKernel::fullPixelCount = 0;
+
+// accumulate weighted SAD of a warped scanline ey (false if any foreground sample overflow)
+template <typename T, int FLAGS, int RADIUS>
+static inline bool accumulateRow(const T *samples, const int camNum, const int ey, const Vec2d &pt, const Mat_<uchar> &refImg, const Mat_<double> &edgeImg, T *c, T &fitness, T &sumWeight) {
+	// MVS
+	const MVS &mvs        = MVS::getInstance();
+	const int patchRadius = (RADIUS > 0) ? RADIUS : mvs.getPatchRadius();
+	const int patchSize   = (RADIUS > 0) ? (RADIUS<<1)+1 : mvs.getPatchSize();
+
+	// pixel-wised variance
+	T mean, avgSad;                  // pixel-wised mean, average sad
+
+	// distance & difference weighting weighting
+	const T gradientWeighting = (T) mvs.getGradientWeight();
+	const Mat_<double> &distWeight = mvs.getPatchDistanceWeighting();
+	T weight;
+
+	const double y = pt[1]-patchRadius+ey;
+	const uchar  *refRow  = refImg.ptr<uchar>(cvRound(y));
+	const double *edgeRow = edgeImg.ptr<double>(cvRound(y));
+	for (int ex = 0; ex < patchSize; ++ex) {
+		const double x = pt[0]-patchRadius+ex;
+
+		// clear
+		mean   = 0;
+		avgSad = 0;
+
+		// skip background
+		if (refRow[cvRound(x)] == 0) continue;
+		// skip no gradient
+		// if (edgeRow[cvRound(x)] == 0.0) continue;
+
+		for (int i = 0; i < camNum; ++i) {
+			c[i] = samples[i*patchSize + ex];
+
+			// skip overflow cases
+			if (c[i] == (T) WarpKernel::OVERFLOW_SAMPLE) {
+				return false;
+			}
+
+			mean += c[i];
+		} // end of camera
+
+		mean /= camNum;
+
+		for (int i = 0; i < camNum; i++) {
+			avgSad += abs(c[i]-mean);
+		}
+		avgSad /= camNum;
+
+		weight = 1;
+		if (FLAGS & FitnessKernel::FLAG_DISTANCE) {   // adaptive distance weighting
+			weight *= (T) distWeight.at<double>(ex, ey);
+		}
+		if (FLAGS & FitnessKernel::FLAG_DIFFERENCE) { // adaptive difference weighting
+			weight *= (T) mvs.getDifferenceWeighting((double) avgSad);
+		}
+		if (FLAGS & FitnessKernel::FLAG_GRADIENT) {   // adaptive gradient maginitude weighting
+			weight *= exp( (T) -1.0 / ((T) edgeRow[cvRound(x)]*gradientWeighting) );
+		}
+		sumWeight += weight;
+		fitness   += weight * avgSad;
+	} // end of warping x
+
+	return true;
+}
+
+/*
+	weighted average SAD of a particle with early termination
+
+	scanlines are visited by descending distance weighting. Every pixel weight
+	is at most its distance weighting (or 1 without adaptive distance), so
+	fitness / (sumWeight + remaining weight) is a lower bound of the final
+	fitness. Once the lower bound exceeds given bound the particle can't win,
+	and the lower bound is returned.
+*/
+template <typename T, int FLAGS, int RADIUS>
+static double particleFitness(const T *h, const Vec2d &pt, const double bound, const Mat_<uchar> * const *imgs, const int camNum, const Mat_<uchar> &refImg, const Mat_<double> &edgeImg, T *samples, T *c, int &rowNum) {
+	// MVS
+	const MVS &mvs                   = MVS::getInstance();
+	const int patchRadius            = (RADIUS > 0) ? RADIUS : mvs.getPatchRadius();
+	const int patchSize              = (RADIUS > 0) ? (RADIUS<<1)+1 : mvs.getPatchSize();
+	const vector<int> &rowOrder      = mvs.getPatchRowOrder();
+	const vector<double> &rowRemain  = mvs.getPatchRowWeightRemain();
+
+	T fitness   = 0;                 // result of normalized fitness
+	T sumWeight = 0;
+	double remain;                   // upper bound of weight of unvisited pixels
+
+	for (int j = 0; j < patchSize; ++j) {
+		const int ey = rowOrder[j];
+		rowNum = j+1;
+
+		// warp scanline into all visible images
+		for (int i = 0; i < camNum; ++i) {
+			WarpKernel::warp(h + i*9, *imgs[i], (T) (pt[0]-patchRadius), (T) (pt[1]-patchRadius+ey), patchSize, samples + i*patchSize);
+		}
+
+		if ( !accumulateRow<T, FLAGS, RADIUS>(samples, camNum, ey, pt, refImg, edgeImg, c, fitness, sumWeight) ) {
+			return DBL_MAX;
+		}
+
+		// bound test (skip last scanline)
+		if (j+1 == patchSize) break;
+		remain = (FLAGS & FitnessKernel::FLAG_DISTANCE) ? rowRemain[j+1] : (double) ((patchSize-j-1)*patchSize);
+		if ((double) fitness > bound * ((double) sumWeight + remain)) {
+			return (double) fitness / ((double) sumWeight + remain);
+		}
+	}
+
+	return (double) (fitness / sumWeight);
+}
+
+// kernel function type of given precision
+template <typename T>
+struct KernelType {
+	typedef double (*Func)(const T *h, const Vec2d &pt, const double bound, const Mat_<uchar> * const *imgs, const int camNum, const Mat_<uchar> &refImg, const Mat_<double> &edgeImg, T *samples, T *c, int &rowNum);
+};
+
+template <typename T, int RADIUS>
+static typename KernelType<T>::Func selectFlags(const int flags) {
+	switch (flags) {
+		case 0x0: return particleFitness<T, 0x0, RADIUS>;
+		case 0x1: return particleFitness<T, 0x1, RADIUS>;
+		case 0x2: return particleFitness<T, 0x2, RADIUS>;
+		case 0x3: return particleFitness<T, 0x3, RADIUS>;
+		case 0x4: return particleFitness<T, 0x4, RADIUS>;
+		case 0x5: return particleFitness<T, 0x5, RADIUS>;
+		case 0x6: return particleFitness<T, 0x6, RADIUS>;
+		default:  return particleFitness<T, 0x7, RADIUS>;
+	}
+}
+
+template <typename T>
+static typename KernelType<T>::Func selectRadius(const int flags, const int patchRadius) {
+	switch (patchRadius) {
+		case 7:  return selectFlags<T, 7>(flags);
+		case 11: return selectFlags<T, 11>(flags);
+		case 15: return selectFlags<T, 15>(flags);
+		default: return selectFlags<T, 0>(flags);
+	}
+}
+
+void FitnessKernel::select(const bool distance, const bool difference, const bool gradient, const int patchRadius) {
+	int flags = 0;
+	if (distance)   flags |= FLAG_DISTANCE;
+	if (difference) flags |= FLAG_DIFFERENCE;
+	if (gradient)   flags |= FLAG_GRADIENT;
+
+	kernelFunc   = selectRadius<double>(flags, patchRadius);
+	kernelFuncF  = selectRadius<float>(flags, patchRadius);
+	kernelRadius = (patchRadius == 7 || patchRadius == 11 || patchRadius == 15) ? patchRadius : 0;
+}
+
+void FitnessKernel::addPixelCount(const long long pixels, const long long fullPixels) {
+	#pragma omp atomic
+	pixelCount += pixels;
+	#pragma omp atomic
+	fullPixelCount += fullPixels;
+}
+
+void FitnessKernel::clearPixelCount() {
+	pixelCount     = 0;
+	fullPixelCount = 0;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef __PAIS_FITNESS_KERNEL_H__
+#define __PAIS_FITNESS_KERNEL_H__
+
+#include <vector>
+#include <opencv2\opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace PAIS {
+	/*
+		weighted average SAD kernel of a particle (early termination by bound)
+
+		kernels are specialized at compile time for the 8 combinations of
+		adaptive distance/difference/gradient weighting and for patch radius
+		7, 11 and 15 (other radius uses the runtime patch radius). The kernel
+		is selected once by MVS::setConfig.
+	*/
+	class FitnessKernel {
+	private:
+		FitnessKernel(void);
+		~FitnessKernel(void);
+
+		typedef double (*KernelFunc)(const double *h, const Vec2d &pt, const double bound, const Mat_<uchar> * const *imgs, const int camNum, const Mat_<uchar> &refImg, const Mat_<double> &edgeImg, double *samples, double *c, int &rowNum);
+		typedef double (*KernelFuncF)(const float *h, const Vec2d &pt, const double bound, const Mat_<uchar> * const *imgs, const int camNum, const Mat_<uchar> &refImg, const Mat_<double> &edgeImg, float *samples, float *c, int &rowNum);
+
+		// selected kernel (double, float)
+		static KernelFunc  kernelFunc;
+		static KernelFuncF kernelFuncF;
+		// specialized patch radius (0: runtime patch radius)
+		static int kernelRadius;
+		// warped pixels of all evaluations and of the same evaluations without early termination
+		static long long pixelCount;
+		static long long fullPixelCount;
+
+	public:
+		// adaptive weighting flags
+		static const int FLAG_DISTANCE   = 0x1;
+		static const int FLAG_DIFFERENCE = 0x2;
+		static const int FLAG_GRADIENT   = 0x4;
+
+		// select kernel of adaptive weighting and patch radius
+		static void select(const bool distance, const bool difference, const bool gradient, const int patchRadius);
+		// specialized patch radius of selected kernel (0: runtime patch radius)
+		static int getKernelRadius() { return kernelRadius; }
+
+		// fitness of a particle, h: homographies of visible cameras (camera number * 9), imgs: visible images
+		// samples: scanline buffer (camera number * patch size), c: color buffer (camera number)
+		// rowNum: visited scanlines (less than patch size if terminated by bound)
+		static double evaluate(const double *h, const Vec2d &pt, const double bound, const Mat_<uchar> * const *imgs, const int camNum, const Mat_<uchar> &refImg, const Mat_<double> &edgeImg, double *samples, double *c, int &rowNum) {
+			return kernelFunc(h, pt, bound, imgs, camNum, refImg, edgeImg, samples, c, rowNum);
+		}
+		static double evaluate(const float *h, const Vec2d &pt, const double bound, const Mat_<uchar> * const *imgs, const int camNum, const Mat_<uchar> &refImg, const Mat_<double> &edgeImg, float *samples, float *c, int &rowNum) {
+			return kernelFuncF(h, pt, bound, imgs, camNum, refImg, edgeImg, samples, c, rowNum);
+		}
+
+		// add warped pixels of a fitness batch (thread safe)
+		static void addPixelCount(const long long pixels, const long long fullPixels);
+		// warped pixel statistics of early termination
+		static long long getPixelCount() { return pixelCount; }
+		static long long getFullPixelCount() { return fullPixelCount; }
+		static void clearPixelCount();
+	};
+};
+
+#endif
\ No newline at end of file
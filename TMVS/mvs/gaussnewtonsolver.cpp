@@ -0,0 +1,297 @@
+#include "gaussnewtonsolver.h"
+#include "patch.h"
+
+using namespace PAIS;
+
+const double GaussNewtonSolver::LAMBDA_MIN       = 1e-6;
+const double GaussNewtonSolver::LAMBDA_MAX       = 1e4;
+const double GaussNewtonSolver::STEP_TOLERANCE   = 1e-4;
+const double GaussNewtonSolver::RESIDUAL_EPSILON = 1.0;
+
+// bilinear sample and its gradient at image point (same interpolant as WarpKernel, false if overflow)
+static inline bool sampleGradient(const Mat_<uchar> &img, const double ix, const double iy, double &c, double &gx, double &gy) {
+	if (ix < 2 || ix >= img.cols-3 || iy < 2 || iy >= img.rows-3) {
+		return false;
+	}
+
+	const int px0 = (int) ix;
+	const int py0 = (int) iy;
+	const double fx = ix - px0;
+	const double fy = iy - py0;
+
+	const uchar *row0 = img.data + py0*img.step;
+	const uchar *row1 = row0 + img.step;
+	const double c00 = row0[px0], c10 = row0[px0+1];
+	const double c01 = row1[px0], c11 = row1[px0+1];
+
+	c  = c00*(1-fx)*(1-fy) + c10*fx*(1-fy) + c01*(1-fx)*fy + c11*fx*fy;
+	gx = (c10-c00)*(1-fy) + (c11-c01)*fy;
+	gy = (c01-c00)*(1-fx) + (c11-c10)*fx;
+	return true;
+}
+
+// solve symmetric positive definite 3x3 system A*x = b by Cholesky decomposition (false if not positive definite)
+static inline bool solveCholesky(const Matx33d &A, const Vec3d &b, Vec3d &x) {
+	double L[3][3] = {{0}};
+	for (int r = 0; r < 3; ++r) {
+		for (int c = 0; c <= r; ++c) {
+			double sum = A(r, c);
+			for (int k = 0; k < c; ++k) {
+				sum -= L[r][k]*L[c][k];
+			}
+			if (r == c) {
+				if (sum <= 0) return false;
+				L[r][r] = sqrt(sum);
+			} else {
+				L[r][c] = sum / L[c][c];
+			}
+		}
+	}
+	// forward (L*y = b) and backward (L^T*x = y) substitution
+	double y[3];
+	for (int r = 0; r < 3; ++r) {
+		y[r] = b[r];
+		for (int k = 0; k < r; ++k) y[r] -= L[r][k]*y[k];
+		y[r] /= L[r][r];
+	}
+	for (int r = 2; r >= 0; --r) {
+		x[r] = y[r];
+		for (int k = r+1; k < 3; ++k) x[r] -= L[k][r]*x[k];
+		x[r] /= L[r][r];
+	}
+	return true;
+}
+
+GaussNewtonSolver::GaussNewtonSolver(void) {
+	const double zero[3] = {0, 0, 0};
+	reset(NULL, zero, zero);
+}
+
+void GaussNewtonSolver::reset(const Patch *patch, const double *rangeL, const double *rangeU, int maxIteration) {
+	this->patch           = patch;
+	this->maxIteration    = maxIteration;
+	this->getFitnessBatch = PAIS::getFitnessBatch;
+	this->iteration       = 0;
+	this->evaluations     = 0;
+	this->maxEvaluations  = 0;
+	this->fitness         = DBL_MAX;
+
+	for (int d = 0; d < 3; d++) {
+		this->rangeL[d] = rangeL[d];
+		this->rangeU[d] = rangeU[d];
+		this->pos[d]    = rangeL[d] + 0.5*(rangeU[d] - rangeL[d]);
+	}
+}
+
+void GaussNewtonSolver::setFitnessBatch(void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj)) {
+	this->getFitnessBatch = getFitnessBatch;
+}
+
+bool GaussNewtonSolver::setInitialGuess(const double *pos) {
+	if (pos == NULL) {
+		printf("set initial guess fail\n");
+		return false;
+	}
+	for (int d = 0; d < 3; d++) {
+		this->pos[d] = pos[d];
+	}
+	clamp(this->pos);
+	return true;
+}
+
+void GaussNewtonSolver::clamp(double *pos) const {
+	for (int d = 0; d < 3; d++) {
+		if (pos[d] > rangeU[d]) pos[d] = rangeU[d];
+		if (pos[d] < rangeL[d]) pos[d] = rangeL[d];
+	}
+}
+
+double GaussNewtonSolver::evaluate(const double *pos, const double bound) {
+	double f;
+	++evaluations;
+	getFitnessBatch(&pos, 1, &bound, &f, (void *) patch);
+	return f;
+}
+
+bool GaussNewtonSolver::linearize(const double *pos, Matx33d &JtJ, Vec3d &Jtr) const {
+	// MVS
+	const MVS &mvs                = MVS::getInstance();
+	const int patchRadius         = mvs.getPatchRadius();
+	const int patchSize           = mvs.getPatchSize();
+	const vector<Camera> &cameras = mvs.getCameras();
+	const Mat_<double> &distWeight = mvs.getPatchDistanceWeighting();
+
+	// current patch
+	const vector<int> &camIdx   = patch->getCameraIndices();
+	const int LOD               = patch->getLOD();
+	const int camNum            = patch->getCameraNumber();
+	const Camera &refCam        = mvs.getCamera(patch->getReferenceCameraIndex());
+	const Mat_<double> &edgeImg = refCam.getPyramidEdge(LOD);
+	const Mat_<uchar>  &refImg  = refCam.getPyramidImage(LOD);
+
+	// plane and its derivatives of (theta, phi, depth)
+	const double st = sin(pos[0]), ct = cos(pos[0]);
+	const double sp = sin(pos[1]), cp = cos(pos[1]);
+	const Vec3d normal(st*cp, st*sp, ct);
+	if (normal.ddot(refCam.getOpticalNormal()) > 0) return false;
+	const Vec3d center = patch->getRay() * pos[2] + refCam.getCenter();
+	const Vec3d dNormal[3] = { Vec3d(ct*cp, ct*sp, -st), Vec3d(-st*sp, st*cp, 0.0), Vec3d(0.0, 0.0, 0.0) };
+	const Vec3d dCenter[3] = { Vec3d(0.0, 0.0, 0.0), Vec3d(0.0, 0.0, 0.0), patch->getRay() };
+
+	// projected point on reference image (center moves along ray, fixed for all parameters)
+	Vec2d pt;
+	if ( !refCam.project(center, pt, LOD) ) return false;
+	if (pt[0]-patchRadius < 2 || pt[0]+patchRadius >= edgeImg.cols-3 || pt[1]-patchRadius < 2 || pt[1]+patchRadius >= edgeImg.rows-3) {
+		return false;
+	}
+
+	// scratch memory of calling thread
+	ScratchScope scratch;
+	Matx33d *H  = scratch.construct<Matx33d>(camNum);
+	Matx33d *dH = scratch.construct<Matx33d>(camNum*3);
+	double  *c  = scratch.alloc<double>(camNum);
+	double  *J  = scratch.alloc<double>(camNum*3);
+
+	// homography engine of pso optimization (otherwise set up for this call)
+	HomographyEngine localEngine;
+	const HomographyEngine *engine = &patch->getHomographyEngine();
+	if ( !engine->isReady() ) {
+		localEngine.setup(cameras, patch->getReferenceCameraIndex(), camIdx, pow(mvs.getLODRatio(), LOD));
+		engine = &localEngine;
+	}
+	engine->getHomographyDerivatives(center, normal, dCenter, dNormal, 3, H, dH);
+
+	JtJ = Matx33d::zeros();
+	Jtr = Vec3d(0.0, 0.0, 0.0);
+	for (int ey = 0; ey < patchSize; ++ey) {
+		const double y = pt[1]-patchRadius+ey;
+		const uchar  *refRow  = refImg.ptr<uchar>(cvRound(y));
+		const double *edgeRow = edgeImg.ptr<double>(cvRound(y));
+		for (int ex = 0; ex < patchSize; ++ex) {
+			const double x = pt[0]-patchRadius+ex;
+
+			// skip background
+			if (refRow[cvRound(x)] == 0) continue;
+
+			// sample and Jacobian of each camera
+			double mean = 0, meanJ[3] = {0, 0, 0};
+			for (int i = 0; i < camNum; ++i) {
+				const Matx33d &h = H[i];
+				const double hx = h(0,0)*x + h(0,1)*y + h(0,2);
+				const double hy = h(1,0)*x + h(1,1)*y + h(1,2);
+				const double w  = h(2,0)*x + h(2,1)*y + h(2,2);
+				if (w == 0) return false;
+				const double ix = hx / w;
+				const double iy = hy / w;
+
+				double gx, gy;
+				if ( !sampleGradient(cameras[camIdx[i]].getPyramidImage(LOD), ix, iy, c[i], gx, gy) ) return false;
+
+				// chain rule: d(ix, iy)/dk = (dh_row0,1 - (ix, iy)*dh_row2) . (x, y, 1) / w
+				for (int k = 0; k < 3; ++k) {
+					const Matx33d &D = dH[i*3 + k];
+					const double dw  = D(2,0)*x + D(2,1)*y + D(2,2);
+					const double dix = (D(0,0)*x + D(0,1)*y + D(0,2) - ix*dw) / w;
+					const double diy = (D(1,0)*x + D(1,1)*y + D(1,2) - iy*dw) / w;
+					J[i*3 + k] = gx*dix + gy*diy;
+					meanJ[k]  += J[i*3 + k];
+				}
+				mean += c[i];
+			}
+			mean /= camNum;
+			meanJ[0] /= camNum;
+			meanJ[1] /= camNum;
+			meanJ[2] /= camNum;
+
+			double avgSad = 0;
+			for (int i = 0; i < camNum; ++i) {
+				avgSad += abs(c[i]-mean);
+			}
+			avgSad /= camNum;
+
+			// pixel weighting of fitness function
+			double weight = 1;
+			if ( mvs.isAdaptiveDistanceEnable() ) {
+				weight *= distWeight.at<double>(ex, ey);
+			}
+			if ( mvs.isAdaptiveDifferenceEnable() ) {
+				weight *= mvs.getDifferenceWeighting(avgSad);
+			}
+			if ( mvs.isAdaptiveGradientEnable() ) {
+				weight *= exp( -1.0 / (edgeRow[cvRound(x)]*mvs.getGradientWeight()) );
+			}
+
+			// reweighted normal equations of residual c_i - mean
+			for (int i = 0; i < camNum; ++i) {
+				const double r  = c[i] - mean;
+				const double wr = weight / max(abs(r), RESIDUAL_EPSILON);
+				const Vec3d  dr(J[i*3] - meanJ[0], J[i*3+1] - meanJ[1], J[i*3+2] - meanJ[2]);
+				for (int a = 0; a < 3; ++a) {
+					Jtr[a] += wr * dr[a] * r;
+					for (int b = 0; b < 3; ++b) {
+						JtJ(a, b) += wr * dr[a] * dr[b];
+					}
+				}
+			}
+		} // end of x
+	} // end of y
+
+	return true;
+}
+
+void GaussNewtonSolver::optimize() {
+	iteration   = 0;
+	evaluations = 0;
+	fitness     = DBL_MAX;
+	if ( !canEvaluate(1) ) return;
+	fitness     = evaluate(pos, DBL_MAX);
+	if (fitness == DBL_MAX) return;
+
+	Matx33d JtJ, A;
+	Vec3d   Jtr, step;
+	double  next[3];
+	double  lambda = LAMBDA_MIN;
+	for (iteration = 0; iteration < maxIteration; iteration++) {
+		if ( !canEvaluate(2) ) break;
+		++evaluations;
+		if ( !linearize(pos, JtJ, Jtr) ) break;
+
+		// damped step until fitness is improved
+		bool improved = false;
+		while (lambda <= LAMBDA_MAX && canEvaluate(1)) {
+			A = JtJ;
+			for (int d = 0; d < 3; d++) {
+				A(d, d) += lambda * JtJ(d, d) + DBL_EPSILON;
+			}
+			if ( !solveCholesky(A, -Jtr, step) ) {
+				lambda *= 10;
+				continue;
+			}
+			for (int d = 0; d < 3; d++) {
+				next[d] = pos[d] + step[d];
+			}
+			clamp(next);
+
+			const double f = evaluate(next, fitness);
+			if (f < fitness) {
+				fitness = f;
+				for (int d = 0; d < 3; d++) {
+					step[d] = next[d] - pos[d];
+					pos[d]  = next[d];
+				}
+				lambda   = max(lambda * 0.1, LAMBDA_MIN);
+				improved = true;
+				break;
+			}
+			lambda *= 10;
+		}
+		if (!improved) break;
+
+		// converged step
+		bool converged = true;
+		for (int d = 0; d < 3; d++) {
+			if (abs(step[d]) > STEP_TOLERANCE * (rangeU[d] - rangeL[d])) converged = false;
+		}
+		if (converged) break;
+	} // end of iteration
+}
\ No newline at end of file
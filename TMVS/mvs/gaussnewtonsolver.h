@@ -0,0 +1,85 @@
+#ifndef __PAIS_GAUSS_NEWTON_SOLVER_H__
+#define __PAIS_GAUSS_NEWTON_SOLVER_H__
+
+#include <opencv2\opencv.hpp>
+
+#include "../pso/optimizer.h"
+
+using namespace cv;
+
+namespace PAIS {
+	class Patch;
+
+	/*
+		Gauss-Newton photometric refinement of patch (theta, phi, depth)
+
+		residual of pixel p in visible camera i is r = c_i(p) - mean(p), the
+		weighted average SAD is minimized as iteratively reweighted least
+		squares (weight: pixel weighting / |r|). Jacobian of c_i is analytic:
+		gradient of bilinear interpolant chained with homography derivative
+		of spherical normal and depth (HomographyEngine). A step is damped
+		(Levenberg-Marquardt) until the fitness function accepts it, so the
+		result is never worse than the initial guess. Iteration needs budget of
+		linearization and one damped step.
+	*/
+	class GaussNewtonSolver : public Optimizer<3> {
+	private:
+		// damping range and relative step tolerance (ratio of search range)
+		static const double LAMBDA_MIN;
+		static const double LAMBDA_MAX;
+		static const double STEP_TOLERANCE;
+		// minimum absolute residual of IRLS weight (intensity)
+		static const double RESIDUAL_EPSILON;
+
+		// refined patch
+		const Patch *patch;
+
+		// number of iteration
+		int iteration;
+		// max number of iteration
+		int maxIteration;
+		// number of fitness evaluation (linearization counted as one)
+		int evaluations;
+		// fitness evaluation budget (0: unlimited)
+		int maxEvaluations;
+
+		// upper and lower range
+		double rangeL[3];
+		double rangeU[3];
+
+		// current solution and fitness
+		double pos[3];
+		double fitness;
+
+		// batch fitness function (acceptance test)
+		void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj);
+
+		// fitness of position under bound
+		double evaluate(const double *pos, const double bound);
+		// num more evaluations are in budget
+		bool canEvaluate(const int num) const { return maxEvaluations <= 0 || evaluations + num <= maxEvaluations; }
+		// normal equations JtWJ and JtWr at position (false if patch warps out of image)
+		bool linearize(const double *pos, Matx33d &JtJ, Vec3d &Jtr) const;
+		// clamp position into range
+		void clamp(double *pos) const;
+
+	public:
+		GaussNewtonSolver(void);
+
+		// re-arm solver with patch and search range (homography engine of patch is used if ready)
+		void reset(const Patch *patch, const double *rangeL, const double *rangeU, int maxIteration = 10);
+
+		// optimizer interface
+		void setFitnessBatch(void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj));
+		bool setInitialGuess(const double *pos);
+		void setMaxEvaluations(const int maxEvaluations) { this->maxEvaluations = maxEvaluations; }
+		void optimize();
+
+		const double* getGbest()          const { return pos; }
+		double        getGbestFitness()   const { return fitness; }
+		int           getIteration()      const { return iteration; }
+		int           getEvaluations()    const { return evaluations; }
+	};
+};
+
+#endif
\ No newline at end of file
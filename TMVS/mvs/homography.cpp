@@ -0,0 +1,118 @@
+#include "homography.h"
+#include "camera.h"
+
+using namespace PAIS;
+
+HomographyEngine::HomographyEngine(void) {
+
+}
+
+HomographyEngine::~HomographyEngine(void) {
+
+}
+
+Matx33d HomographyEngine::toMatx(const Mat_<double> &m) {
+	Matx33d mx;
+	for (int r = 0; r < 3; ++r) {
+		for (int c = 0; c < 3; ++c) {
+			mx(r, c) = m.at<double>(r, c);
+		}
+	}
+	return mx;
+}
+
+Vec3d HomographyEngine::toVec(const Mat_<double> &m) {
+	return Vec3d(m.at<double>(0, 0), m.at<double>(1, 0), m.at<double>(2, 0));
+}
+
+void HomographyEngine::setup(const vector<Camera> &cameras, const int refCamIdx, const vector<int> &camIdx, const double lodScalar) {
+	const int camNum = (int) camIdx.size();
+
+	// LOD scalar for camera intrisic matrix K
+	const Matx33d LODM(lodScalar, 0.0, 0.0, 0.0, lodScalar, 0.0, 0.0, 0.0, 1.0);
+
+	// reference camera
+	const Camera &refCam = cameras[refCamIdx];
+	refInvA = (LODM * toMatx(refCam.getKR())).inv();
+	refU    = refInvA * (LODM * toVec(refCam.getKT()));
+
+	base.resize(camNum);
+	shift.resize(camNum);
+	identity.resize(camNum);
+	for (int i = 0; i < camNum; ++i) {
+		identity[i] = (camIdx[i] == refCamIdx);
+
+		const Camera &cam = cameras[camIdx[i]];
+		const Matx33d A   = LODM * toMatx(cam.getKR());
+		const Vec3d   b   = LODM * toVec(cam.getKT());
+		base[i]  = A * refInvA;
+		shift[i] = A * refU - b;
+	}
+}
+
+void HomographyEngine::clear() {
+	base.clear();
+	shift.clear();
+	identity.clear();
+}
+
+void HomographyEngine::getHomographies(const Vec3d &center, const Vec3d &normal, Matx33d *H) const {
+	const int camNum = getCameraNumber();
+
+	// plane equation (distance form plane to origin)
+	const double d = -center.ddot(normal);
+
+	// v / s
+	const double s = d - normal.ddot(refU);
+	const Vec3d  v = (refInvA.t() * normal) * (1.0 / s);
+
+	for (int i = 0; i < camNum; ++i) {
+		// indentity for reference camera
+		if (identity[i]) {
+			H[i] = Matx33d::eye();
+			continue;
+		}
+
+		const Matx33d &B = base[i];
+		const Vec3d   &e = shift[i];
+		for (int r = 0; r < 3; ++r) {
+			H[i](r, 0) = B(r, 0) + e[r]*v[0];
+			H[i](r, 1) = B(r, 1) + e[r]*v[1];
+			H[i](r, 2) = B(r, 2) + e[r]*v[2];
+		}
+	}
+}
+
+void HomographyEngine::getHomographyDerivatives(const Vec3d &center, const Vec3d &normal, const Vec3d *dCenter, const Vec3d *dNormal, const int paramNum, Matx33d *H, Matx33d *dH) const {
+	const int camNum = getCameraNumber();
+	getHomographies(center, normal, H);
+
+	// plane equation (distance form plane to origin)
+	const double d = -center.ddot(normal);
+	const double s = d - normal.ddot(refU);
+	const Matx33d refInvAT = refInvA.t();
+	const Vec3d  v = (refInvAT * normal) * (1.0 / s);
+
+	for (int k = 0; k < paramNum; ++k) {
+		// derivative of v / s
+		const double dd = -(dCenter[k].ddot(normal) + center.ddot(dNormal[k]));
+		const double ds = dd - dNormal[k].ddot(refU);
+		const Vec3d  dv = (refInvAT * dNormal[k]) * (1.0 / s) - v * (ds / s);
+
+		for (int i = 0; i < camNum; ++i) {
+			Matx33d &D = dH[i*paramNum + k];
+			// constant identity for reference camera
+			if (identity[i]) {
+				D = Matx33d::zeros();
+				continue;
+			}
+
+			const Vec3d &e = shift[i];
+			for (int r = 0; r < 3; ++r) {
+				D(r, 0) = e[r]*dv[0];
+				D(r, 1) = e[r]*dv[1];
+				D(r, 2) = e[r]*dv[2];
+			}
+		}
+	}
+}
\ No newline at end of file
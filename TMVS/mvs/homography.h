@@ -0,0 +1,66 @@
+#ifndef __PAIS_HOMOGRAPHY_H__
+#define __PAIS_HOMOGRAPHY_H__
+
+#include <vector>
+#include <opencv2\opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace PAIS {
+	class Camera;
+
+	/*
+		plane induced homography from reference camera to visible cameras
+
+		with A = L*K*R, b = L*K*T (L: LOD scalar) of each camera and plane
+		(n, d), homography H_i = (d*A_i - b_i*n^T) * (d*A_r - b_r*n^T)^-1.
+		By Sherman-Morrison formula
+
+			H_i = A_i*A_r^-1 + (A_i*u - b_i) * v^T / s,
+			u = A_r^-1 * b_r, v = A_r^-T * n, s = d - n^T*u
+
+		A_i*A_r^-1 and A_i*u - b_i are set up once per patch, each plane is
+		a rank-1 update without allocation. Derivative of plane parameter k is
+		rank-1 as well, dH_i = (A_i*u - b_i) * dv^T with
+
+			dv = A_r^-T * dn / s - v * ds / s,
+			ds = dd - dn^T*u, dd = -(dc^T*n + c^T*dn)
+	*/
+	class HomographyEngine {
+	private:
+		// A_r^-1
+		Matx33d refInvA;
+		// A_r^-1 * b_r
+		Vec3d refU;
+		// A_i * A_r^-1 of visible cameras
+		vector<Matx33d> base;
+		// A_i * u - b_i of visible cameras
+		vector<Vec3d> shift;
+		// reference camera (identity homography)
+		vector<char> identity;
+
+		static Matx33d toMatx(const Mat_<double> &m);
+		static Vec3d   toVec(const Mat_<double> &m);
+
+	public:
+		HomographyEngine(void);
+		~HomographyEngine(void);
+
+		// set up from reference camera index and visible camera indices in given LOD
+		void setup(const vector<Camera> &cameras, const int refCamIdx, const vector<int> &camIdx, const double lodScalar);
+		// release set up
+		void clear();
+
+		bool isReady()        const { return !base.empty();    }
+		int getCameraNumber() const { return (int) base.size(); }
+
+		// homographies of plane through center with normal (H: camera number)
+		void getHomographies(const Vec3d &center, const Vec3d &normal, Matx33d *H) const;
+		// homographies and their derivatives of plane parameters
+		// (dCenter, dNormal: derivatives of center and normal of each parameter, dH: camera-major, camera number * paramNum)
+		void getHomographyDerivatives(const Vec3d &center, const Vec3d &normal, const Vec3d *dCenter, const Vec3d *dNormal, const int paramNum, Matx33d *H, Matx33d *dH) const;
+	};
+};
+
+#endif
\ No newline at end of file
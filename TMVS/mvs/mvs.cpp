@@ -4,17 +4,23 @@ using namespace PAIS;
 
 MVS* MVS::instance = NULL;
 
-struct PatchDist {
-	int id;
-	double dist;
-};
 struct PatchNeighbor {
 	int id;
 	vector<int> nid;
 };
 
-bool patchDistCompare(const PatchDist &p1, const PatchDist &p2) {
-	return (p1.dist < p2.dist);
+// refinement task of patch pointer list
+static void refinePatchTask(const int idx, void *obj) {
+	Patch &pth = *(*((vector<Patch*> *) obj))[idx];
+	pth.refine();
+	pth.removeInvisibleCamera();
+}
+
+// refinement task of patch list
+static void refineCandidateTask(const int idx, void *obj) {
+	Patch &pth = (*((vector<Patch> *) obj))[idx];
+	pth.refine();
+	pth.removeInvisibleCamera();
 }
 
 /* constructor */
@@ -64,11 +70,67 @@ void MVS::setConfig(const MvsConfig &config) {
 	this->particleNum              = config.particleNum;
 	this->maxIteration             = config.maxIteration;
 	this->expansionStrategy        = config.expansionStrategy;
+	this->singlePrecisionEnable    = config.singlePrecisionEnable;
+	this->normalQuantum            = config.normalQuantum;
+	this->depthQuantum             = config.depthQuantum;
+	this->randomSeed               = config.randomSeed;
+	this->optimizer                = config.optimizer;
+	this->warmStartEnable          = config.warmStartEnable;
+	this->lockstepEnable           = config.lockstepEnable;
+	this->relativeThreshold        = config.relativeThreshold;
+	this->stagnationIteration      = config.stagnationIteration;
+	this->evaluationBudget         = config.evaluationBudget;
+	this->swarmInit                = config.swarmInit;
+	this->expansionBatch           = config.expansionBatch;
+	this->threadNum                = config.threadNum;
+	this->threadAffinity           = config.threadAffinity;
+	this->subtaskEnable            = config.subtaskEnable;
 	this->patchSize                = (patchRadius<<1)+1;
 
+	// lockstep advances swarms, optimizer without swarm refines one by one
+	if (lockstepEnable && (optimizer == OPTIMIZER_SIMPLEX || optimizer == OPTIMIZER_GAUSS_NEWTON)) {
+		printf("swarm lockstep needs pso optimizer, disabled\n");
+		this->lockstepEnable = false;
+	}
+
 	printConfig();
 
 	initPatchDistanceWeighting();
+	initDifferenceWeighting();
+
+	// fitness kernel of adaptive weighting and patch radius
+	FitnessKernel::select(adaptiveDistanceEnable, adaptiveDifferenceEnable, adaptiveGradientEnable, patchRadius);
+
+	initScratchArena();
+
+	// workers of refinement tasks
+	TaskPool::setup(threadNum, threadAffinity, subtaskEnable);
+}
+
+void MVS::initDifferenceWeighting() {
+	diffWeightTable.resize(DIFF_TABLE_SIZE);
+	double s;
+	for (int i = 0; i < DIFF_TABLE_SIZE; ++i) {
+		s = (double) i / DIFF_TABLE_SCALE;
+		diffWeightTable[i] = exp(-s*s/diffWeighting);
+	}
+}
+
+void MVS::initScratchArena() {
+	// camera number bound (cameras may not be loaded yet)
+	const size_t camNum   = (size_t) max((int) cameras.size(), minCamNum);
+	// seed patch swarm is the largest
+	const size_t num      = (size_t) particleNum*2;
+	const size_t pixelNum = (size_t) patchSize*patchSize;
+	const size_t align    = ScratchArena::ALIGNMENT;
+
+	// batch fitness: homographies, points, valid flags, images, scanline samples, colors (double)
+	const size_t fitness = num*camNum*9*sizeof(double) + num*sizeof(Vec2d) + num + camNum*(sizeof(Matx33d) + sizeof(void*))
+	                     + num*camNum*patchSize*sizeof(double) + num*camNum*sizeof(double) + 8*align;
+	// correlation table: homography patches (double)
+	const size_t correlation = camNum*pixelNum*sizeof(double) + align;
+
+	ScratchArena::setBlockSize(max(fitness, correlation));
 }
 
 bool MVS::initCellMaps() {
@@ -87,10 +149,27 @@ bool MVS::initCellMaps() {
 }
 
 void MVS::initPriorityQueue() {
-	queue.clear();
-	map<int, Patch>::const_iterator it;
+	switch (expansionStrategy) {
+	default:
+	case EXPANSION_BEST_FIRST:
+	case EXPANSION_FRONTIER:
+		queue.clear(PatchQueue::ORDER_MIN_PRIORITY);
+		break;
+	case EXPANSION_WORST_FIRST:
+		queue.clear(PatchQueue::ORDER_MAX_PRIORITY);
+		break;
+	case EXPANSION_BREATH_FIRST:
+		queue.clear(PatchQueue::ORDER_FIFO);
+		break;
+	case EXPANSION_DEPTH_FIRST:
+		queue.clear(PatchQueue::ORDER_LIFO);
+		break;
+	}
+
+	// ascending id order (hot priority, patch data is not touched)
+	PatchMap::const_iterator it;
 	for (it = patches.begin(); it != patches.end(); ++it) {
-		queue.push_back(it->second.getId());
+		queue.push(it.getId(), patches.getPriority(it.getSlot()));
 	}
 }
 
@@ -111,15 +190,31 @@ void MVS::initPatchDistanceWeighting() {
 
 	Scalar n = sum(patchDistWeight);
 	patchDistWeight = patchDistWeight / n[0];
+
+	// scanline (fixed y) visiting order by descending scanline weight (center first)
+	vector<pair<double, int> > rowWeight(patchSize);
+	for (int y = 0; y < patchSize; ++y) {
+		rowWeight[y].first  = -sum(patchDistWeight.col(y))[0];
+		rowWeight[y].second = y;
+	}
+	sort(rowWeight.begin(), rowWeight.end());
+
+	patchRowOrder.resize(patchSize);
+	patchRowWeightRemain.resize(patchSize+1);
+	patchRowWeightRemain[patchSize] = 0;
+	for (int i = patchSize-1; i >= 0; --i) {
+		patchRowOrder[i]        = rowWeight[i].second;
+		patchRowWeightRemain[i] = patchRowWeightRemain[i+1] - rowWeight[i].first;
+	}
 }
 
 void MVS::setCellMaps() {
 	initCellMaps();
 
-	map<int, Patch>::iterator it;
+	PatchMap::iterator it;
 	int camNum, cx, cy;
 	for (it = patches.begin(); it != patches.end(); ++it) {
-		Patch &pth                     = it->second;
+		Patch &pth                     = *it;
 		camNum                         = pth.getCameraNumber();
 		const vector<Vec2d> &imgPoints = pth.getImagePoints();
 		const vector<int> &camIdx      = pth.getCameraIndices();
@@ -135,11 +230,12 @@ void MVS::setCellMaps() {
 void MVS::reCentering() {
 	int count = 1;
 	int num   = (int) patches.size();
-	map<int, Patch>::iterator it;
+	PatchMap::iterator it;
 	for (it = patches.begin(); it != patches.end(); ++it, ++count) {
 		printf("\rre-triangulation: %d / %d", count, num);
-		Patch &pth = it->second;
+		Patch &pth = *it;
 		pth.reCentering();
+		patches.update(pth.getId());
 	}
 	printf("\n");
 }
@@ -201,18 +297,42 @@ void MVS::refineSeedPatches() {
 
 	setNeighborRadius();
 
-	map<int, Patch>::iterator it;
-	for (it = patches.begin(); it != patches.end(); ) {
-		Patch &pth = it->second;
+	PatchMap::iterator it;
 
+	// refine seed patches as tasks when thread number is configured
+	const bool taskEnable = (threadNum > 0);
+	if (taskEnable) {
 		// remove patch with few visible camera
-		if (pth.getCameraNumber() < minCamNum) {
-			it = deletePatch(pth);
-			continue;
+		vector<Patch*> seeds;
+		for (it = patches.begin(); it != patches.end(); ) {
+			Patch &pth = *it;
+			if (pth.getCameraNumber() < minCamNum) {
+				it = deletePatch(pth);
+				continue;
+			}
+			seeds.push_back(&pth);
+			++it;
 		}
 
-		pth.refine();
-		pth.removeInvisibleCamera();
+		TaskPool::run((int) seeds.size(), refinePatchTask, &seeds);
+	}
+
+	for (it = patches.begin(); it != patches.end(); ) {
+		Patch &pth = *it;
+
+		// serial refinement
+		if (!taskEnable) {
+			// remove patch with few visible camera
+			if (pth.getCameraNumber() < minCamNum) {
+				it = deletePatch(pth);
+				continue;
+			}
+
+			pth.refine();
+			pth.removeInvisibleCamera();
+		}
+		// refined in place
+		patches.update(pth.getId());
 
 		if ( !runtimeFiltering(pth) ) {
 			it = deletePatch(pth);
@@ -231,6 +351,23 @@ void MVS::refineSeedPatches() {
 }
 
 void MVS::expansionPatches() {
+	FitnessCache::clearTotal();
+
+	if (expansionStrategy == EXPANSION_FRONTIER) {
+		frontierExpansionPatches();
+	} else if (expansionBatch > 0) {
+		parallelExpansionPatches();
+	} else {
+		serialExpansionPatches();
+	}
+
+	// fitness cache of all expansion swarms
+	if (FitnessCache::getTotalQueries() > 0) {
+		LogManager::log("expansion cache\tquery\t%lld\thit rate\t%f", FitnessCache::getTotalQueries(), FitnessCache::getTotalHitRate());
+	}
+}
+
+void MVS::serialExpansionPatches() {
 	// initialize cell maps (project seed patches)
 	setCellMaps();
 	// initialize seed patch into priority queue
@@ -240,14 +377,12 @@ void MVS::expansionPatches() {
 
 	int pthId = getPatchIdFromQueue();
 	int saveTime = 0;
-	while ( !queue.empty() ) {
-		// get top priority seed patch
-		Patch *pthP = getPatch(pthId);
-		// skip if not found
-		if (pthP == NULL) continue;
-		Patch &pth = *pthP;
+	while (pthId >= 0) {
+		// get top priority seed patch (queue skips deleted and expanded patches)
+		Patch &pth = *getPatch(pthId);
 
 		pth.setExpanded();
+		patches.update(pthId);
 
 		printf("parent: fit: %f \t pri: %f \t camNum: %d\n", pth.getFitness(), pth.getPriority(), pth.getCameraNumber());
 		
@@ -261,6 +396,8 @@ void MVS::expansionPatches() {
 
 		// expand patch
 		expandNeighborCell(pth);
+		// final swarm is only inherited by expansion patches
+		pth.releaseSwarm();
 		
 		if (patches.size() / 500 > saveTime) {
 			saveTime++;
@@ -274,6 +411,178 @@ void MVS::expansionPatches() {
 	setNeighborRadius();
 }
 
+void MVS::parallelExpansionPatches() {
+	// initialize cell maps (project seed patches)
+	setCellMaps();
+	// initialize seed patch into priority queue
+	initPriorityQueue();
+	// set neighbor radius from bounding volume
+	setNeighborRadius();
+
+	vector<int>   parents;
+	vector<PatchMap::Handle> parentHandles;
+	vector<Patch> children;
+	vector<Vec3i> cells;
+	int saveTime = 0;
+	int round    = 0;
+	long long commits   = 0;
+	long long conflicts = 0;
+	long long filtered  = 0;
+
+	while (true) {
+		// parents of this round in queue order
+		parents.clear();
+		while ( (int) parents.size() < expansionBatch ) {
+			const int pthId = getPatchIdFromQueue();
+			if (pthId < 0) break;
+
+			Patch &pth = *getPatch(pthId);
+			pth.setExpanded();
+			patches.update(pthId);
+
+			// skip
+			if ( !runtimeFiltering(pth) ) {
+				printf("Top priority patch deleted\n");
+				deletePatch(pth);
+				continue;
+			}
+			parents.push_back(pthId);
+		}
+		if ( parents.empty() ) break;
+
+		// expansion candidates of all parents against current cell occupancy
+		children.clear();
+		cells.clear();
+		parentHandles.clear();
+		for (int i = 0; i < (int) parents.size(); ++i) {
+			Patch &pth = *getPatch(parents[i]);
+			collectNeighborCell(pth, children, cells);
+			parentHandles.resize(children.size(), patches.getHandle(parents[i]));
+			// final swarm is only inherited by expansion patches
+			pth.releaseSwarm();
+		}
+
+		// refine candidates concurrently as tasks
+		const int num = (int) children.size();
+		TaskPool::run(num, refineCandidateTask, &children);
+
+		// optimistic commit in candidate order, cell filled by an earlier commit is a conflict
+		for (int i = 0; i < num; ++i) {
+			// parent erased since collection is a conflict as well
+			const Patch *parent = patches.get(parentHandles[i]);
+			const int result = (parent != NULL) ? commitExpansion(children[i], cells[i], *parent) : COMMIT_CONFLICT;
+			if (result == COMMIT_INSERTED) {
+				commits++;
+			} else if (result == COMMIT_FILTERED) {
+				filtered++;
+			} else {
+				conflicts++;
+			}
+		}
+		round++;
+
+		if (patches.size() / 500 > saveTime) {
+			saveTime++;
+			writeMVS("auto_save.mvs");
+		}
+	}
+
+	printf("parallel expansion: rounds %d commits %lld conflicts %lld filtered %lld\n", round, commits, conflicts, filtered);
+	LogManager::log("parallel expansion\trounds\t%d\tcommits\t%lld\tconflicts\t%lld\tfiltered\t%lld", round, commits, conflicts, filtered);
+
+	setNeighborRadius();
+}
+
+void MVS::frontierExpansionPatches() {
+	// initialize cell maps (project seed patches)
+	setCellMaps();
+	// initialize seed patch into priority queue
+	initPriorityQueue();
+	// set neighbor radius from bounding volume
+	setNeighborRadius();
+
+	vector<PatchMap::Handle> parentHandles;
+	vector<Patch>  children;
+	vector<Vec3i>  cells;
+	set<long long> claimed;
+	// (refined priority, patch id) key and candidate index
+	vector<pair<pair<double, int>, int> > order;
+	int saveTime = 0;
+	int round    = 0;
+	long long candidates = 0;
+	long long commits    = 0;
+	long long conflicts  = 0;
+	long long filtered   = 0;
+
+	while (true) {
+		// whole frontier of unexpanded patches in priority order
+		children.clear();
+		cells.clear();
+		parentHandles.clear();
+		claimed.clear();
+		int frontier = 0;
+		while (true) {
+			const int pthId = getPatchIdFromQueue();
+			if (pthId < 0) break;
+
+			Patch &pth = *getPatch(pthId);
+			pth.setExpanded();
+			patches.update(pthId);
+
+			// skip
+			if ( !runtimeFiltering(pth) ) {
+				deletePatch(pth);
+				continue;
+			}
+
+			// candidates against cells at round start, one candidate per cell (higher priority parent)
+			collectNeighborCell(pth, children, cells, &claimed);
+			parentHandles.resize(children.size(), patches.getHandle(pthId));
+			// final swarm is only inherited by expansion patches
+			pth.releaseSwarm();
+			frontier++;
+		}
+		if (frontier == 0) break;
+
+		// refine all candidates as tasks
+		const int num = (int) children.size();
+		TaskPool::run(num, refineCandidateTask, &children);
+		candidates += num;
+
+		// commit survivors by refined priority (ties by patch id), independent of thread count
+		order.clear();
+		for (int i = 0; i < num; ++i) {
+			if ( children[i].isDropped() ) continue;
+			order.push_back( make_pair(make_pair(children[i].getPriority(), children[i].getId()), i) );
+		}
+		sort(order.begin(), order.end());
+		for (int k = 0; k < (int) order.size(); ++k) {
+			const int i = order[k].second;
+			const Patch *parent = patches.get(parentHandles[i]);
+			const int result = (parent != NULL) ? commitExpansion(children[i], cells[i], *parent) : COMMIT_CONFLICT;
+			if (result == COMMIT_INSERTED) {
+				commits++;
+			} else if (result == COMMIT_FILTERED) {
+				filtered++;
+			} else {
+				conflicts++;
+			}
+		}
+		round++;
+		printf("frontier round %d: parents %d candidates %d patches %d\n", round, frontier, num, (int) patches.size());
+
+		if (patches.size() / 500 > saveTime) {
+			saveTime++;
+			writeMVS("auto_save.mvs");
+		}
+	}
+
+	printf("frontier expansion: rounds %d candidates %lld commits %lld conflicts %lld filtered %lld\n", round, candidates, commits, conflicts, filtered);
+	LogManager::log("frontier expansion\trounds\t%d\tcandidates\t%lld\tcommits\t%lld\tconflicts\t%lld\tfiltered\t%lld", round, candidates, commits, conflicts, filtered);
+
+	setNeighborRadius();
+}
+
 /* filtering */
 
 void MVS::cellFiltering() {
@@ -302,15 +611,13 @@ void MVS::cellFiltering() {
 					corrSum = 0;
 					for (int k = 0; k < pthNum; ++k) {
 						if (j == k) continue;
-						const Patch *pthP = getPatch(cell[k]);
-						if (pthP == NULL) continue;
-						const Patch &pth = *pthP;
-						corrSum += pth.getCorrelation();
+						const int slot = patches.getSlot(cell[k]);
+						if (slot < 0) continue;
+						corrSum += patches.getCorrelation(slot);
 					}
-					const Patch *pthP = getPatch(cell[j]);
-					if (pthP == NULL) continue;
-					const Patch &pth = *pthP;
-					if (pth.getCorrelation() * pth.getCameraNumber() < corrSum) {
+					const int slot = patches.getSlot(cell[j]);
+					if (slot < 0) continue;
+					if (patches.getCorrelation(slot) * patches.getCameraNumber(slot) < corrSum) {
 						removeIdx.push_back(cell[j]);
 					}
 				}
@@ -352,9 +659,8 @@ void MVS::neighborCellFiltering(const double neighborRatio) {
 				// center cell
 				for (int j = 0; j < pthNum; ++j) {
 					// center patch
-					const Patch *centerPthP = getPatch(cell[j]);
-					if (centerPthP == NULL) continue;
-					const Patch &centerPth = *centerPthP;
+					const int centerSlot = patches.getSlot(cell[j]);
+					if (centerSlot < 0) continue;
 
 					int neighborPthSum = 0;
 					int neighborPthNum = 0;
@@ -369,11 +675,10 @@ void MVS::neighborCellFiltering(const double neighborRatio) {
 						neighborPthSum += neighborCellPthNum;
 
 						for (int k = 0; k < neighborCellPthNum; ++k) {
-							const Patch *neighborPthP = getPatch(neighborCell[k]);
-							if (neighborPthP == NULL) continue;
-							const Patch &neighborPth = *neighborPthP;
+							const int neighborSlot = patches.getSlot(neighborCell[k]);
+							if (neighborSlot < 0) continue;
 
-							if ( Patch::isNeighbor(centerPth, neighborPth) ) {
+							if ( patches.isNeighbor(centerSlot, neighborSlot, neighborRadius) ) {
 								++neighborPthNum;
 							}
 						} // end of neighbor patch
@@ -381,7 +686,7 @@ void MVS::neighborCellFiltering(const double neighborRatio) {
 
 					// mark as remove
 					if ((double) neighborPthNum / (double) neighborPthSum < neighborRatio) {
-						removeIdx.push_back(centerPth.getId());
+						removeIdx.push_back(cell[j]);
 					}
 				} // end of center cell
 
@@ -402,11 +707,11 @@ void MVS::visibilityFiltering() {
 		setCellMaps();
 	}
 
-	map<int, Patch>::iterator it;
+	PatchMap::iterator it;
 	int camNum, cx, cy;
 	double depth, neighborDepth;
 	for (it = patches.begin(); it != patches.end(); ) {
-		Patch &pth = it->second;
+		Patch &pth = *it;
 		camNum = pth.getCameraNumber();
 		const vector<Vec2d> &imgPoints = pth.getImagePoints();
 		const vector<int> &camIdx = pth.getCameraIndices();
@@ -424,10 +729,9 @@ void MVS::visibilityFiltering() {
 			const int pthNum = (int) cell.size();
 			for (int p = 0; p < pthNum; ++p) {
 				if (cell[p] == pth.getId()) continue;
-				const Patch *pthP = getPatch(cell[p]);
-				if (pthP == NULL) continue;
-				const Patch &pth = *pthP;
-				neighborDepth = norm(pth.getCenter() - cam.getCenter());
+				const int slot = patches.getSlot(cell[p]);
+				if (slot < 0) continue;
+				neighborDepth = norm(patches.getCenter(slot) - cam.getCenter());
 				if (depth > neighborDepth) {
 					--visibleCount;
 					break;
@@ -451,56 +755,40 @@ void MVS::neighborPatchFiltering(const double neighborRatio) {
 		setCellMaps();
 	}
 
-	// copy patch id
-	vector<int> patchIds;
-	for (map<int, Patch>::const_iterator it = patches.begin(); it != patches.end(); ++it) {
-		const Patch &pth = it->second; // current patch
-		patchIds.push_back(pth.getId());
+	// copy stored slots (hot centers)
+	vector<int> patchSlots;
+	const int slotNum = patches.getSlotNumber();
+	for (int s = 0; s < slotNum; ++s) {
+		if ( patches.isStored(s) ) patchSlots.push_back(s);
 	}
+	const int pthNum = (int) patchSlots.size();
+	const double radius2 = neighborRadius * neighborRadius;
 
 	// patch neighbor information
 	vector<PatchNeighbor> neighbor;
 
-	// check k nearest neighbor of each patch
+	// collect neighbors within neighbor radius of each patch
 	int count = 1;
 	#pragma omp parallel for
-	for (int i = 0; i < (int) patchIds.size(); ++i) {
+	for (int i = 0; i < pthNum; ++i) {
 		#pragma omp critical
 		{
-			printf("\rfiltering: %d / %d", count++, patches.size());
-		}
-
-		const Patch *pthP = getPatch(patchIds[i]); // current patch
-		if (pthP == NULL) continue;
-		const Patch &pth = *pthP;
-
-		vector<PatchDist> dist;              // dist container
-		for (map<int, Patch>::const_iterator itN = patches.begin(); itN != patches.end(); ++itN) {
-			const Patch &pthN = itN->second; // current neighbor patch
-
-			// skip self
-			if (pthN.getId() == pth.getId()) continue;
-
-			// distance object
-			PatchDist pthDist;
-			pthDist.id   = pthN.getId();
-			pthDist.dist = norm(pth.getCenter() - pthN.getCenter());
-
-			dist.push_back(pthDist);
+			printf("\rfiltering: %d / %d", count++, pthNum);
 		}
 
-		// sort by distance
-		sort(dist.begin(), dist.end(), patchDistCompare);
+		const int slot = patchSlots[i]; // current patch
+		const Vec3d &center = patches.getCenter(slot);
 
 		// get local neighbor information
 		PatchNeighbor pn;
-		pn.id = pth.getId();
-		for (int i = 0; i < (int) dist.size(); ++i) {
-			const Patch *pthNP = getPatch(dist[i].id);
-			if (pthNP == NULL) continue;
-			const Patch &pthN = *pthNP;
-			if (dist[i].dist > neighborRadius) break;
-			pn.nid.push_back(pthN.getId());
+		pn.id = patches.getSlotId(slot);
+		for (int j = 0; j < pthNum; ++j) {
+			// skip self
+			if (j == i) continue;
+
+			const Vec3d d = center - patches.getCenter(patchSlots[j]);
+			if (d.dot(d) > radius2) continue;
+			pn.nid.push_back(patches.getSlotId(patchSlots[j]));
 		}
 		#pragma omp critical
 		{
@@ -527,6 +815,21 @@ void MVS::neighborPatchFiltering(const double neighborRatio) {
 /* process */
 
 void MVS::expandNeighborCell(const Patch &pth) {
+	// refine siblings together, then commit in expansion order
+	if (lockstepEnable) {
+		vector<Patch> siblings;
+		vector<Vec3i> siblingCells;
+		collectNeighborCell(pth, siblings, siblingCells);
+		if (siblings.empty()) return;
+
+		Patch::refineLockstep(siblings);
+		for (int k = 0; k < (int) siblings.size(); ++k) {
+			siblings[k].removeInvisibleCamera();
+			commitExpansion(siblings[k], siblingCells[k], pth);
+		}
+		return;
+	}
+
 	const int camNum               = pth.getCameraNumber();
 	const vector<int> &camIdx      = pth.getCameraIndices();
 	const vector<Vec2d> &imgPoints = pth.getImagePoints();
@@ -563,6 +866,53 @@ void MVS::expandNeighborCell(const Patch &pth) {
 	} // end of cameras
 }
 
+void MVS::collectNeighborCell(const Patch &pth, vector<Patch> &children, vector<Vec3i> &cells, set<long long> *claimed) const {
+	const int camNum               = pth.getCameraNumber();
+	const vector<int> &camIdx      = pth.getCameraIndices();
+	const vector<Vec2d> &imgPoints = pth.getImagePoints();
+
+	int cx, cy;
+	for (int i = 0; i < camNum; ++i) {
+		const Camera &cam  = cameras[camIdx[i]];
+		const CellMap &map = cellMaps[camIdx[i]];
+
+		// position on cell map
+		cx = (int) (imgPoints[i][0] / cellSize);
+		cy = (int) (imgPoints[i][1] / cellSize);
+
+		// check neighbor cells
+		int nx [] = {cx-1, cx  , cx+1, cx  };
+		int ny [] = {cy  , cy-1, cy  , cy+1};
+
+		for (int j = 0; j < 4; ++j) {
+			// skip out of map
+			if ( !map.inMap(nx[j], ny[j]) ) continue;
+
+			// skip neighbor cell with exist neighbor patch or discontinuous
+			if ( skipNeighborCell(map.getCell(nx[j], ny[j]), pth) ) continue;
+
+			// skip cell claimed by other parent (key: camera index, cx, cy)
+			if (claimed != NULL) {
+				const long long key = ((long long) camIdx[i] << 40) | ((long long) nx[j] << 20) | (long long) ny[j];
+				if ( !claimed->insert(key).second ) continue;
+			}
+
+			// unrefined expansion patch of cell
+			Vec3d center;
+			getExpansionPatchCenter(cam, pth, nx[j], ny[j], center);
+			children.push_back(Patch(center, pth));
+			cells.push_back(Vec3i(camIdx[i], nx[j], ny[j]));
+		} // end of neighbor cell
+	} // end of cameras
+}
+
+int MVS::commitExpansion(const Patch &pth, const Vec3i &cell, const Patch &parent) {
+	// skip cell filled since collection (previous sibling or concurrent expansion)
+	if ( skipNeighborCell(cellMaps[cell[0]].getCell(cell[1], cell[2]), parent) ) return COMMIT_CONFLICT;
+
+	return insertPatch(pth) ? COMMIT_INSERTED : COMMIT_FILTERED;
+}
+
 void MVS::expandCell(const PAIS::Camera &cam, const Patch &parent, const int cx, const int cy) {
 	// get expansion patch center
 	Vec3d center;
@@ -576,8 +926,8 @@ void MVS::expandCell(const PAIS::Camera &cam, const Patch &parent, const int cx,
 	insertPatch(expPatch);
 }
 
-void MVS::insertPatch(const Patch &pth) {
-	if ( !runtimeFiltering(pth) ) return;
+bool MVS::insertPatch(const Patch &pth) {
+	if ( !runtimeFiltering(pth) ) return false;
 
 	const int camNum = pth.getCameraNumber();
 	const vector<Vec2d> &imgPoints = pth.getImagePoints();
@@ -585,9 +935,9 @@ void MVS::insertPatch(const Patch &pth) {
 	int cx, cy;
 
 	// insert into patches container
-	patches.insert(pair<int, Patch>(pth.getId(), pth));
+	patches.insert(pth);
 	// insert into priority queue
-	queue.push_back(pth.getId());
+	queue.push(pth.getId(), pth.getPriority());
 	
 	// insert into cell maps
 	for (int i = 0; i < camNum; ++i) {
@@ -598,19 +948,21 @@ void MVS::insertPatch(const Patch &pth) {
 
 	// dispatch viewer update event
 	addPatchView(pth);
+
+	return true;
 }
 
-map<int, Patch>::iterator MVS::deletePatch(Patch &pth) {
+PatchMap::iterator MVS::deletePatch(Patch &pth) {
 	return deletePatch(pth.getId());
 }
 
-map<int, Patch>::iterator MVS::deletePatch(const int id) {
-	map<int, Patch>::iterator it = patches.find(id);
-	if (it == patches.end()) return patches.end();
+PatchMap::iterator MVS::deletePatch(const int id) {
+	const Patch *pthP = patches.find(id);
+	if (pthP == NULL) return patches.end();
 
 	// remove from cell maps
 	if(!cellMaps.empty()) {
-		const Patch &pth = it->second;
+		const Patch &pth = *pthP;
 		const int camNum = pth.getCameraNumber();
 		const vector<int> &camIdx = pth.getCameraIndices();
 		const vector<Vec2d> &imgPoints = pth.getImagePoints();
@@ -623,29 +975,24 @@ map<int, Patch>::iterator MVS::deletePatch(const int id) {
 		}
 	}
 
+	// remove from expansion queue
+	queue.remove(id);
+
 	// push to deleted patches container
-	deletedPatches.push_back(it->second);
+	deletedPatches.push_back(*pthP);
 
-	return patches.erase(it);
+	return patches.erase(id);
 }
 
 int MVS::getPatchIdFromQueue() const {
 	int id = -1;
 
-	switch (expansionStrategy) {
-	default:
-	case EXPANSION_BEST_FIRST:
-		id = getTopPriorityPatchId();
-		break;
-	case EXPANSION_WORST_FIRST:
-		id = getLastPriorityPatchId();
-		break;
-	case EXPANSION_BREATH_FIRST:
-		id = getBreathFirstPatchId();
-		break;
-	case EXPANSION_DEPTH_FIRST:
-		id = getDepthFirstPatchId();
-		break;
+	// skip deleted or expanded patch
+	while ( !queue.empty() ) {
+		id = queue.pop();
+		const int slot = patches.getSlot(id);
+		if (slot >= 0 && !patches.isExpanded(slot)) break;
+		id = -1;
 	}
 
 	printf("queue %d patches %d\n", queue.size(), patches.size());
@@ -653,140 +1000,6 @@ int MVS::getPatchIdFromQueue() const {
 	return id;
 }
 
-int MVS::getTopPriorityPatchId() const {
-	vector<int>::iterator it;
-	vector<int>::iterator topIt = queue.end();
-	double topPriority = DBL_MAX;
-
-	for (it = queue.begin(); it != queue.end();) { 
-		const Patch *pthP = getPatch(*it);
-		if (pthP == NULL) {
-			it = queue.erase(it);
-			continue;
-		}
-		const Patch &pth = *pthP;
-
-		// skip expanded
-		if ( pth.isExpanded() ) {
-			it = queue.erase(it);
-			continue;
-		}
-
-		// update top priority
-		if (pth.getPriority() < topPriority) {
-			topPriority = pth.getPriority();
-			topIt       = it;
-		}
-
-		++it;
-	}
-
-	int topId = -1;
-
-	// delete top id from queue
-	if (topIt != queue.end()) {
-		topId = *topIt;
-		queue.erase(topIt);
-	}
-
-	return topId;
-}
-
-int MVS::getLastPriorityPatchId() const {
-	vector<int>::iterator it;
-	vector<int>::iterator topIt = queue.end();
-	double topPriority = -DBL_MAX;
-
-	for (it = queue.begin(); it != queue.end();) { 
-		const Patch *pthP = getPatch(*it);
-		if (pthP == NULL) {
-			it = queue.erase(it);
-			continue;
-		}
-		const Patch &pth = *pthP;
-
-		// skip expanded
-		if ( pth.isExpanded() ) {
-			it = queue.erase(it);
-			continue;
-		}
-
-		// update top priority
-		if (pth.getPriority() > topPriority) {
-			topPriority = pth.getPriority();
-			topIt       = it;
-		}
-
-		++it;
-	}
-
-	int topId = -1;
-
-	// delete top id from queue
-	if (topIt != queue.end()) {
-		topId = *topIt;
-		queue.erase(topIt);
-	}
-
-	return topId;
-}
-
-int MVS::getBreathFirstPatchId() const {
-	vector<int>::iterator it;
-	int topId = -1;
-
-	for (it = queue.begin(); it != queue.end();) {
-		const Patch *pthP = getPatch(*it);
-		if (pthP == NULL) {
-			it = queue.erase(it);
-			continue;
-		}
-		const Patch &pth = *pthP;
-
-		// skip expanded
-		if ( pth.isExpanded() ) {
-			it = queue.erase(it);
-			continue;
-		}
-
-		topId = *it;
-		break;
-	}
-
-	queue.erase(it);
-
-	return topId;
-}
-
-int MVS::getDepthFirstPatchId() const {
-	vector<int>::iterator it;
-	int topId = -1;
-
-	for (it = queue.end()-1; it != queue.begin();) {
-		const Patch *pthP = getPatch(*it);
-		if (pthP == NULL) {
-			queue.erase(it);
-			it = queue.end()-1;
-			continue;
-		}
-		const Patch &pth = *pthP;
-
-		// skip expanded
-		if ( pth.isExpanded() ) {
-			queue.erase(it);
-			it = queue.end()-1;
-			continue;
-		}
-
-		topId = *it;
-		break;
-	}
-
-	queue.erase(it);
-
-	return topId;
-}
-
 /* const function */
 
 bool MVS::skipNeighborCell(const vector<int> &cell, const Patch &refPth) const {
@@ -950,25 +1163,82 @@ void MVS::printConfig() const {
 	case EXPANSION_DEPTH_FIRST:
 		printf("expansion strategy:\tDepth first\n");
 		break;
+	case EXPANSION_FRONTIER:
+		printf("expansion strategy:\tFrontier rounds\n");
+		break;
+	}
+	if (singlePrecisionEnable) {
+		printf("fitness precision:\tsingle\n");
+	} else {
+		printf("fitness precision:\tdouble\n");
 	}
+	if (normalQuantum > 0 && depthQuantum > 0) {
+		printf("fitness cache quantum:\tnormal %f\tdepth %f\n", normalQuantum, depthQuantum);
+	} else {
+		printf("fitness cache:\tdisable\n");
+	}
+	printf("random seed:\t%d\n", randomSeed);
+	switch (optimizer) {
+	default:
+	case OPTIMIZER_PSO:
+		printf("optimizer:\tPSO\n");
+		break;
+	case OPTIMIZER_SIMPLEX:
+		printf("optimizer:\tSimplex\n");
+		break;
+	case OPTIMIZER_PSO_SIMPLEX:
+		printf("optimizer:\tPSO + Simplex polish\n");
+		break;
+	case OPTIMIZER_GAUSS_NEWTON:
+		printf("optimizer:\tGauss-Newton\n");
+		break;
+	case OPTIMIZER_PSO_GAUSS_NEWTON:
+		printf("optimizer:\tPSO + Gauss-Newton polish\n");
+		break;
+	}
+	printf("swarm warm start:\t%s\n", warmStartEnable ? "enable" : "disable");
+	printf("swarm lockstep:\t%s\n", lockstepEnable ? "enable" : "disable");
+	printf("relative convergence threshold:\t%f\n", relativeThreshold);
+	printf("stagnation iteration:\t%d\n", stagnationIteration);
+	printf("evaluation budget:\t%d\n", evaluationBudget);
+	if (swarmInit == SWARM_INIT_HALTON) {
+		printf("swarm initialization:\tHalton\n");
+	} else {
+		printf("swarm initialization:\trandom\n");
+	}
+	if (expansionBatch > 0) {
+		printf("expansion:\tparallel (%d parents per round)\n", expansionBatch);
+	} else {
+		printf("expansion:\tserial\n");
+	}
+	printf("task pool:\t%d threads\taffinity %s\tsubtask %s\n", threadNum, threadAffinity ? "enable" : "disable", subtaskEnable ? "enable" : "disable");
 	printf("-------------------------------\n");
 }
 
+void MVS::printSolverStatistics() const {
+	printf("PSO termination\n");
+	for (int i = PsoSolver<3>::STOP_MAX_ITERATION; i < PsoSolver<3>::STOP_REASON_NUM; i++) {
+		const char *name = PsoSolver<3>::getStopReasonName(i);
+		const long long count = PsoSolver<3>::getStopCount(i);
+		printf("%s:\t%lld\n", name, count);
+		LogManager::log("pso stop\t%s\t%lld", name, count);
+	}
+
+	// warped pixels with early termination by pBest bound (full: without termination)
+	const long long pixels     = FitnessKernel::getPixelCount();
+	const long long fullPixels = FitnessKernel::getFullPixelCount();
+	const double ratio = (fullPixels > 0) ? (double) pixels / fullPixels : 1.0;
+	printf("fitness pixels:\t%lld / %lld (%f)\n", pixels, fullPixels, ratio);
+	LogManager::log("fitness pixels\t%lld\tfull\t%lld\tratio\t%f", pixels, fullPixels, ratio);
+}
+
 /* getter */
 const Patch* MVS::getPatch(const int id) const {
-	if ( patches.find(id) != patches.end() ) {
-		return &patches.at(id);
-	} else {
-		return NULL;
-	}
+	return patches.find(id);
 }
 
 Patch* MVS::getPatch(const int id) {
-	if ( patches.find(id) != patches.end() ) {
-		return &patches.at(id);
-	} else {
-		return NULL;
-	}
+	return patches.find(id);
 }
 
 double MVS::getBoundingVolume(Vec3d *minPtr, Vec3d *maxPtr) const {
@@ -980,11 +1250,11 @@ double MVS::getBoundingVolume(Vec3d *minPtr, Vec3d *maxPtr) const {
 	maxP[0] = -DBL_MAX;
 	maxP[1] = -DBL_MAX;
 	maxP[2] = -DBL_MAX;
-	map<int, Patch>::const_iterator it;
-
-	for (it = patches.begin(); it != patches.end(); ++it) {
-		const Patch &pth = it->second;
-		const Vec3d &center = pth.getCenter();
+	// slot scan of hot centers
+	const int slotNum = patches.getSlotNumber();
+	for (int s = 0; s < slotNum; ++s) {
+		if ( !patches.isStored(s) ) continue;
+		const Vec3d &center = patches.getCenter(s);
 		for (int i = 0; i < 3; ++i) {
 			if (center[i] < minP[i]) minP[i] = center[i];
 			if (center[i] > maxP[i]) maxP[i] = center[i];
@@ -3,10 +3,14 @@
 
 #include <math.h>
 #define _USE_MATH_DEFINES
+#include <set>
 
 #include "../io/fileloader.h"
 #include "../io/filewriter.h"
 #include "cellmap.h"
+#include "patchqueue.h"
+#include "patchmap.h"
+#include "taskpool.h"
 
 // trigger viewer event
 extern void addPatchView(const Patch &pth);
@@ -67,8 +71,40 @@ namespace PAIS {
 		int particleNum;
 		// maximum iteration number
 		int maxIteration;
-		// expansion strategy (best, worst, breath, depth)
+		// expansion strategy (best, worst, breath, depth, frontier rounds)
 		int expansionStrategy;
+		// single precision (float) fitness evaluation
+		bool singlePrecisionEnable;
+		// fitness cache quantum of normal (radian) and depth (ratio of depth range), 0: disable
+		double normalQuantum;
+		double depthQuantum;
+		// random seed of pso solvers (combined with patch id, same seed gives same reconstruction)
+		int randomSeed;
+		// optimization backend of patch refinement
+		// (PSO: 0, simplex: 1, PSO + simplex polish: 2, Gauss-Newton: 3, PSO + Gauss-Newton polish: 4)
+		int optimizer;
+		// seed expansion swarm from final swarm of parent patch
+		bool warmStartEnable;
+		// advance swarms of sibling expansion patches in lockstep (batched fitness evaluation,
+		// swarm backends only: disabled by setConfig with simplex or Gauss-Newton optimizer)
+		bool lockstepEnable;
+		// PSO adaptive stopping (0: disable each)
+		// per dimension convergence threshold (ratio of search range)
+		double relativeThreshold;
+		// iterations without gBest improvement
+		int stagnationIteration;
+		// fitness evaluation budget per patch (doubled for seed patch)
+		int evaluationBudget;
+		// initial swarm position (random: 0, Halton low-discrepancy: 1)
+		int swarmInit;
+		// parent patches expanded per parallel round (0: serial expansion, lockstep is not used in parallel rounds)
+		int expansionBatch;
+		// task pool worker number (0: processor number, seed patches are refined serially)
+		int threadNum;
+		// pin task pool workers to processors
+		bool threadAffinity;
+		// inner loops of refinement (cameras, particles) as subtasks of patch task
+		bool subtaskEnable;
 	};
 
 	class MVS : private MvsConfig {
@@ -83,13 +119,19 @@ namespace PAIS {
 		// camera container
 		vector<Camera>  cameras;
 		// patch container (id, patch)
-		map<int, Patch> patches;
+		PatchMap patches;
 		// cell map container
 		vector<CellMap> cellMaps;
 		// pixel-wised distance weighting of patch
 		Mat_<double> patchDistWeight;
-		// priority queue (patch id)
-		mutable vector<int> queue;
+		// patch scanline visiting order of fitness (descending distance weighting)
+		vector<int> patchRowOrder;
+		// distance weighting of unvisited scanlines (i: number of visited scanlines)
+		vector<double> patchRowWeightRemain;
+		// difference weighting table exp(-s*s/diffWeighting), s = i / DIFF_TABLE_SCALE
+		vector<double> diffWeightTable;
+		// expansion queue (patch id) ordered by expansion strategy
+		mutable PatchQueue queue;
 		// deleted patch container
 		vector<Patch> deletedPatches;
 		
@@ -108,6 +150,10 @@ namespace PAIS {
 		void initPriorityQueue();
 		// initial pixel-wised distance weighting of patch
 		void initPatchDistanceWeighting();
+		// initial difference weighting table
+		void initDifferenceWeighting();
+		// initial block size of per-thread scratch arenas
+		void initScratchArena();
 		// re-centering patches
 		void reCentering();
 
@@ -118,20 +164,28 @@ namespace PAIS {
 		void expandNeighborCell(const Patch &pth);
 		// expansion cell
 		void expandCell(const Camera &cam, const Patch &parent, const int cx, const int cy);
+		// collect unrefined expansion patches of one ring neighbor cells (cell: camera index, cx, cy)
+		// (optional: skip and add cells in claimed cell keys)
+		void collectNeighborCell(const Patch &pth, vector<Patch> &children, vector<Vec3i> &cells, set<long long> *claimed = NULL) const;
+		// commit result of expansion patch
+		static const int COMMIT_INSERTED = 0x00; // inserted into patches
+		static const int COMMIT_CONFLICT = 0x01; // cell filled since collection
+		static const int COMMIT_FILTERED = 0x02; // rejected by runtime filtering
+		// insert refined expansion patch unless its cell was filled since collection
+		int commitExpansion(const Patch &pth, const Vec3i &cell, const Patch &parent);
+		// expansion of one parent at a time in priority order
+		void serialExpansionPatches();
+		// expansion of parent batches with concurrently refined candidates and optimistic commits
+		void parallelExpansionPatches();
+		// bulk-synchronous expansion of whole frontier per round (deduplicated cells, commits in priority order)
+		void frontierExpansionPatches();
 
 		/*****************
 			get patch id from queue
 		******************/
-		// get patch id from queue (entry function)
+		// get next patch id from queue by expansion strategy (-1: empty)
+		// (best first: min priority heap, worst first: max priority heap, breath first: FIFO, depth first: LIFO)
 		int getPatchIdFromQueue() const;
-		// get top priority patch id from queue to expansion (best first)
-		int getTopPriorityPatchId() const;
-		// get last priority patch id from queue to expansion (worst first)
-		int getLastPriorityPatchId() const;
-		// get next patch id from queue to expansion (breath first)
-		int getBreathFirstPatchId() const;
-		// get next patch id from queue to expansion (depth first)
-		int getDepthFirstPatchId() const;
 
 		// check neighbor patches in cell
 		bool skipNeighborCell(const vector<int> &cell, const Patch &refPth) const;
@@ -143,11 +197,11 @@ namespace PAIS {
 		/*****************
 			misc functions
 		******************/
-		// insert new patch in patch pool and queue
-		void insertPatch(const Patch &pth);
+		// insert new patch in patch pool and queue (false: filtered out)
+		bool insertPatch(const Patch &pth);
 		// delete patch and return next patch iterator and push deleted patch into deleted patches container
-		map<int, Patch>::iterator deletePatch(Patch &pth);
-		map<int, Patch>::iterator deletePatch(const int id);
+		PatchMap::iterator deletePatch(Patch &pth);
+		PatchMap::iterator deletePatch(const int id);
 		// set neighbor radius from bounding volume
 		void setNeighborRadius();
 
@@ -163,6 +217,22 @@ namespace PAIS {
 		static const int EXPANSION_WORST_FIRST  = 0x01;
 		static const int EXPANSION_BREATH_FIRST = 0x02;
 		static const int EXPANSION_DEPTH_FIRST  = 0x03;
+		static const int EXPANSION_FRONTIER     = 0x04;
+
+		// patch optimization backend
+		static const int OPTIMIZER_PSO         = 0x00;
+		static const int OPTIMIZER_SIMPLEX     = 0x01;
+		static const int OPTIMIZER_PSO_SIMPLEX = 0x02;
+		static const int OPTIMIZER_GAUSS_NEWTON     = 0x03;
+		static const int OPTIMIZER_PSO_GAUSS_NEWTON = 0x04;
+
+		// initial swarm position
+		static const int SWARM_INIT_RANDOM = 0x00;
+		static const int SWARM_INIT_HALTON = 0x01;
+
+		// difference weighting table samples per intensity level, range [0, 256]
+		static const int DIFF_TABLE_SCALE = 4;
+		static const int DIFF_TABLE_SIZE  = 256*DIFF_TABLE_SCALE+2;
 
 		/*****************
 			instance getter
@@ -197,13 +267,17 @@ namespace PAIS {
 		// get camera by its index
 		const Camera& getCamera(const int idx)          const { return cameras[idx];    }
 		// get system patches
-		const map<int, Patch>& getPatches()             const { return patches;         }
+		const PatchMap& getPatches()                    const { return patches;         }
 		// get deleted patches
 		const vector<Patch>& getDeletedPatches()        const { return deletedPatches;  }
 		// get system cell maps
 		const vector<CellMap>& getCellMaps()            const { return cellMaps;        }
 		// get pre-computed patch distance matrix (same size of patch size)
 		const Mat_<double>& getPatchDistanceWeighting() const { return patchDistWeight; }
+		// get patch scanline visiting order of fitness
+		const vector<int>& getPatchRowOrder()           const { return patchRowOrder;   }
+		// get distance weighting of unvisited scanlines
+		const vector<double>& getPatchRowWeightRemain() const { return patchRowWeightRemain; }
 		// get patch by id
 		const Patch* getPatch(const int id) const;
 		
@@ -216,14 +290,26 @@ namespace PAIS {
 		double getDistanceWeight()     const { return distWeighting;      }
 		double getGradientWeight()     const { return gradientWeighting;  }
 		int    getMinLOD()             const { return minLOD;             }
+		double getLODRatio()           const { return lodRatio;           }
 		double getReduceNormalRange()  const { return reduceNormalRange;  }
 		double getBoundingVolume(Vec3d *minPtr, Vec3d *maxPtr) const;
 		bool isAdaptiveDistanceEnable()   const { return adaptiveDistanceEnable;   }
 		bool isAdaptiveDifferenceEnable() const { return adaptiveDifferenceEnable; }
 		bool isAdaptiveGradientEnable()   const { return adaptiveGradientEnable;   }
+		bool isSinglePrecisionEnable()    const { return singlePrecisionEnable;    }
+
+		// adaptive difference weighting exp(-avgSad*avgSad/diffWeighting) interpolated from table
+		double getDifferenceWeighting(const double avgSad) const {
+			const double s = avgSad * DIFF_TABLE_SCALE;
+			if ( !(s < DIFF_TABLE_SIZE-1) ) return diffWeightTable[DIFF_TABLE_SIZE-1];
+			const int i = (int) s;
+			return diffWeightTable[i] + (s-i) * (diffWeightTable[i+1] - diffWeightTable[i]);
+		}
 
 		// print config information
 		void printConfig() const;
+		// print termination reasons of pso solves
+		void printSolverStatistics() const;
 
 		/* refine seed patches */
 		void refineSeedPatches();
@@ -2,6 +2,19 @@
 
 using namespace PAIS;
 
+// initial simplex step (ratio of search range) of simplex optimization and PSO polish
+static const double SIMPLEX_STEP = 0.1;
+static const double POLISH_STEP  = 0.02;
+// maximum iteration of Gauss-Newton refinement
+static const int GAUSS_NEWTON_ITERATION = 10;
+// kept particles of final swarm (warm start of expansion patches)
+static const int WARM_START_PARTICLE = 8;
+
+// fitness evaluation task of swarm list (lockstep)
+static void evaluateSwarmTask(const int idx, void *obj) {
+	(*((vector<PsoSolver<3>*> *) obj))[idx]->evaluate();
+}
+
 /* static functions */
 bool Patch::isNeighbor(const Patch &pth1, const Patch &pth2) {
 	const MVS &mvs = mvs.getInstance();
@@ -30,6 +43,7 @@ Patch::Patch(const Vec3d &center, const Vec3b &color, const vector<int> &camIdx,
     this->camIdx   = camIdx;
     this->imgPoint = imgPoint;
 	this->drop     = false;
+	this->evaluations = 0;
 	setEstimatedNormal();
 }
 
@@ -38,6 +52,8 @@ Patch::Patch(const Vec3d &center, const Patch &parent, const int id) : AbstractP
     this->center    = center;
 	this->camIdx    = parent.getCameraIndices();
 	this->drop      = false;
+	this->evaluations = 0;
+	this->swarm     = parent.swarm;
 	setNormal(parent.getNormal());
 	expandVisibleCamera();
 }
@@ -49,6 +65,7 @@ Patch::Patch(const Vec3d &center, const Vec2d &normalS, const vector<int> &camId
 	this->fitness     = fitness;
 	this->correlation = correlation;
 	this->drop        = false;
+	this->evaluations = 0;
 	setNormal(normalS);
 	setReferenceCameraIndex();
 	setDepthAndRay();
@@ -114,20 +131,8 @@ void Patch::reCentering() {
 void Patch::refine() {
 	const MVS &mvs = MVS::getInstance();
 
-	// skip few cameras
-	if (getCameraNumber() < mvs.minCamNum) {
-		fitness  = DBL_MAX;
-		priority = DBL_MAX;
-		drop = true;
-		return;
-	}
-
-	setReferenceCameraIndex();
-	setDepthAndRay();
-	setDepthRange();
-	setLOD();
-
-	if (drop) return;
+	evaluations = 0;
+	if ( !beginRefinement() ) return;
 
 	int beforeRefCamIdx = refCamIdx;
 	int afterRefCamIdx  = -1;
@@ -136,6 +141,9 @@ void Patch::refine() {
 	int count           = 0; // optimization counter
 	int totalCamNum     = beforeCamNum;
 
+	// solver of calling thread, re-armed for every optimization
+	PooledSolver<3> solver;
+
 	// re-optimization when reference camera index or visible cameras are changed
 	while ( (beforeRefCamIdx != afterRefCamIdx || beforeCamNum != afterCamNum) && count++ <= totalCamNum ) {
 
@@ -150,20 +158,10 @@ void Patch::refine() {
 		beforeCamNum    = getCameraNumber();
 
 		// do pso optimization (update center and normal)
-		psoOptimization();
+		psoOptimization(*solver);
 
-		// skip fail optimization
-		if (fitness > mvs.maxFitness) {
-			drop = true;
-			return;
-		}
-
-		// update information
-		removeInvisibleCamera();
-		setReferenceCameraIndex();
-		setDepthAndRay();
-		setDepthRange();
-		setLOD();
+		// skip fail optimization and update information
+		if ( !updateRefinement() ) return;
 
 		if (type == TYPE_EXPAND) break;
 
@@ -175,50 +173,318 @@ void Patch::refine() {
 	setImagePoint();
 }
 
+void Patch::refineLockstep(vector<Patch> &patches) {
+	const MVS &mvs = MVS::getInstance();
+
+	// lockstep runs swarms only, other backends refine one by one (setConfig disables lockstep for them)
+	if (mvs.optimizer == MVS::OPTIMIZER_SIMPLEX || mvs.optimizer == MVS::OPTIMIZER_GAUSS_NEWTON) {
+		for (int i = 0; i < (int) patches.size(); i++) {
+			patches[i].refine();
+		}
+		return;
+	}
+
+	// armed swarm of each refined patch (one optimization for expansion patch)
+	vector<Patch*>        pths;
+	vector<PsoSolver<3>*> solvers;
+	vector<clock_t>       starts;
+	for (int i = 0; i < (int) patches.size(); i++) {
+		Patch &pth = patches[i];
+		// refine() begins its own refinement
+		if (pth.type != TYPE_EXPAND) {
+			pth.refine();
+			continue;
+		}
+
+		pth.evaluations = 0;
+		if ( !pth.beginRefinement() ) continue;
+
+		PsoSolver<3> *solver = SolverPool<3>::acquire();
+		starts.push_back( pth.armSwarm(*solver) );
+		solver->begin(true);
+		pths.push_back(&pth);
+		solvers.push_back(solver);
+	}
+
+	// advance all swarms together, fitness of running sibling swarms is evaluated as one task batch
+	const int num = (int) pths.size();
+	vector<PsoSolver<3>*> running(solvers);
+	while ( !running.empty() ) {
+		TaskPool::run((int) running.size(), evaluateSwarmTask, &running);
+
+		int n = 0;
+		for (int i = 0; i < (int) running.size(); i++) {
+			if ( running[i]->advance() ) running[n++] = running[i];
+		}
+		running.resize(n);
+	}
+
+	for (int i = 0; i < num; i++) {
+		Patch &pth = *pths[i];
+		pth.finishSwarm(*solvers[i], starts[i]);
+		SolverPool<3>::release(solvers[i]);
+
+		if ( !pth.updateRefinement() ) continue;
+		pth.setPriority();
+		pth.setImagePoint();
+	}
+}
+
+void Patch::releaseSwarm() {
+	vector<float>().swap(swarm);
+}
+
 /* process */
 
-void Patch::psoOptimization() {
+bool Patch::beginRefinement() {
 	const MVS &mvs = MVS::getInstance();
 
-	// PSO parameter range (theta, phi, depth)
-    double rangeL [] = {0.0 , normalS[1] - M_PI/2.0, depthRange[0]};
-    double rangeU [] = {M_PI, normalS[1] + M_PI/2.0, depthRange[1]};
+	// skip few cameras
+	if (getCameraNumber() < mvs.minCamNum) {
+		fitness  = DBL_MAX;
+		priority = DBL_MAX;
+		drop = true;
+		return false;
+	}
+
+	setReferenceCameraIndex();
+	setDepthAndRay();
+	setDepthRange();
+	setLOD();
+
+	return !drop;
+}
+
+bool Patch::updateRefinement() {
+	const MVS &mvs = MVS::getInstance();
+
+	// skip fail optimization
+	if (fitness > mvs.maxFitness) {
+		drop = true;
+		return false;
+	}
+
+	// update information
+	removeInvisibleCamera();
+	setReferenceCameraIndex();
+	setDepthAndRay();
+	setDepthRange();
+	setLOD();
+	return true;
+}
 
-    // initial guess particle
-    double init   [] = {normalS[0], normalS[1], depth};
+void Patch::getSearchSpace(double *rangeL, double *rangeU, double *init, int &maxIteration, int &particleNum) const {
+	const MVS &mvs = MVS::getInstance();
 
-	PsoSolver *solver = NULL;
+	// PSO parameter range (theta, phi, depth)
+	rangeL[0] = 0.0;
+	rangeU[0] = M_PI;
+	rangeL[1] = normalS[1] - M_PI/2.0;
+	rangeU[1] = normalS[1] + M_PI/2.0;
+	rangeL[2] = depthRange[0];
+	rangeU[2] = depthRange[1];
+
+	// initial guess particle
+	init[0] = normalS[0];
+	init[1] = normalS[1];
+	init[2] = depth;
+
+	maxIteration = mvs.maxIteration;
+	particleNum  = mvs.particleNum;
 	if (type == TYPE_SEED) {
-		solver = new PsoSolver(3, rangeL, rangeU, PAIS::getFitness, this, mvs.maxIteration*2, mvs.particleNum*2 );
+		maxIteration *= 2;
+		particleNum  *= 2;
 	} else {
 		// reduce normal search range for expansion patch
 		rangeL[0] = max(  0.0, normalS[0] - M_PI/mvs.reduceNormalRange);
 		rangeU[0] = min( M_PI, normalS[0] + M_PI/mvs.reduceNormalRange);
 		rangeL[1] = normalS[1] - M_PI/mvs.reduceNormalRange;
 		rangeU[1] = normalS[1] + M_PI/mvs.reduceNormalRange;
-		solver = new PsoSolver(3, rangeL, rangeU, PAIS::getFitness, this, mvs.maxIteration, mvs.particleNum);
+	}
+}
+
+int Patch::getEvaluationBudget() const {
+	const MVS &mvs = MVS::getInstance();
+	if (mvs.evaluationBudget <= 0) return 0;
+	return (type == TYPE_SEED) ? mvs.evaluationBudget*2 : mvs.evaluationBudget;
+}
+
+void Patch::psoOptimization(PsoSolver<3> &solver) {
+	const MVS &mvs = MVS::getInstance();
+
+	// swarm backends (PSO and PSO with polish)
+	if (mvs.optimizer != MVS::OPTIMIZER_SIMPLEX && mvs.optimizer != MVS::OPTIMIZER_GAUSS_NEWTON) {
+		const clock_t start_t = armSwarm(solver);
+		solver.optimize();
+		finishSwarm(solver, start_t);
+		return;
+	}
+
+	double rangeL[3], rangeU[3], init[3];
+	int maxIteration, particleNum;
+	getSearchSpace(rangeL, rangeU, init, maxIteration, particleNum);
+
+	// camera terms of homographies shared by all evaluations
+	homographyEngine.setup(mvs.getCameras(), refCamIdx, camIdx, pow(mvs.lodRatio, LOD));
+
+	const clock_t start_t = clock();
+
+	SimplexSolver<3>  simplex;
+	GaussNewtonSolver gaussNewton;
+	Optimizer<3> *optimizer = NULL;
+	if (mvs.optimizer == MVS::OPTIMIZER_SIMPLEX) {
+		// simplex from initial guess (1~2 evaluations per iteration)
+		simplex.reset(rangeL, rangeU, PAIS::getFitness, this, maxIteration*2, SIMPLEX_STEP);
+		optimizer = &simplex;
+	} else {
+		// Gauss-Newton from initial guess (parent estimate of expansion patch)
+		gaussNewton.reset(this, rangeL, rangeU, GAUSS_NEWTON_ITERATION);
+		optimizer = &gaussNewton;
+	}
+
+	const int budget = getEvaluationBudget();
+	optimizer->setFitnessBatch(PAIS::getFitnessBatch);
+	optimizer->setInitialGuess(init);
+	optimizer->setMaxEvaluations( (budget > 0) ? max(budget - evaluations, 1) : 0 );
+	optimizer->optimize();
+	evaluations += optimizer->getEvaluations();
+
+	setOptimizationResult(*optimizer, optimizer->getIteration(), clock() - start_t);
+	homographyEngine.clear();
+}
+
+clock_t Patch::armSwarm(PsoSolver<3> &solver) {
+	const MVS &mvs = MVS::getInstance();
+
+	double rangeL[3], rangeU[3], init[3];
+	int maxIteration, particleNum;
+	getSearchSpace(rangeL, rangeU, init, maxIteration, particleNum);
+
+	// camera terms of homographies shared by all particles
+	homographyEngine.setup(mvs.getCameras(), refCamIdx, camIdx, pow(mvs.lodRatio, LOD));
+
+	const clock_t start_t = clock();
+
+	solver.reset(rangeL, rangeU, PAIS::getFitness, this, maxIteration, particleNum);
+	solver.setInitMode( (mvs.swarmInit == MVS::SWARM_INIT_HALTON) ? PsoSolver<3>::INIT_HALTON : PsoSolver<3>::INIT_RANDOM );
+
+	// per patch random seed, independent of refinement order among threads
+	solver.setRandomSeed( ((unsigned long long) (unsigned int) mvs.randomSeed << 32) | (unsigned int) getId() );
+
+	// fitness cache of quantized (theta, phi, depth)
+	if (mvs.normalQuantum > 0 && mvs.depthQuantum > 0) {
+		const double quantum [] = {mvs.normalQuantum, mvs.normalQuantum, mvs.depthQuantum * (depthRange[1]-depthRange[0])};
+		solver.setFitnessCache(quantum);
+	}
+
+	// adaptive stopping, evaluation budget is shared by optimizations of this refinement
+	const int budget = getEvaluationBudget();
+	solver.setStopCriteria(mvs.relativeThreshold, mvs.stagnationIteration, (budget > 0) ? max(budget - evaluations, 1) : 0);
+
+	// evaluate whole swarm per fitness call
+	solver.setFitnessBatch(PAIS::getFitnessBatch);
+	solver.setInitialGuess(init);
+
+	// warm start: parent swarm around initial guess (offsets scaled into search range of this patch),
+	// at most half of the particles are seeded to keep random exploration
+	if (mvs.warmStartEnable && type == TYPE_EXPAND) {
+		const int seedNum = min((int) swarm.size() / 3, particleNum / 2);
+		for (int k = 0; k < seedNum; k++) {
+			double p[3];
+			for (int d = 0; d < 3; d++) {
+				p[d] = init[d] + swarm[k*3 + d] * (rangeU[d] - rangeL[d]);
+				p[d] = min(max(p[d], rangeL[d]), rangeU[d]);
+			}
+			solver.setParticle(p, NULL, k+1);
+		}
 	}
 
-	clock_t start_t, end_t;
-	start_t = clock();
-	solver->setParticle(init);
-    solver->run(true);
-	end_t = clock();
+	return start_t;
+}
+
+void Patch::finishSwarm(PsoSolver<3> &solver, const clock_t start_t) {
+	const MVS &mvs = MVS::getInstance();
+
+	int iteration = solver.getIteration();
+	evaluations  += solver.getEvaluations();
+
+	// keep final swarm for warm start of expansion patches (pBest offsets from gBest in search range unit)
+	if (mvs.warmStartEnable) {
+		double best[(WARM_START_PARTICLE+1)*3];
+		const int num = solver.getBestParticles(best, WARM_START_PARTICLE+1);
+		const double *rangeL = solver.getRangeL();
+		const double *rangeU = solver.getRangeU();
+		swarm.resize( max(num-1, 0) * 3 );
+		for (int k = 1; k < num; k++) {
+			for (int d = 0; d < 3; d++) {
+				swarm[(k-1)*3 + d] = (float) ((best[k*3 + d] - best[d]) / (rangeU[d] - rangeL[d]));
+			}
+		}
+	}
+
+	// local polish of gBest in the rest of evaluation budget (never worse than gBest)
+	const int budget = getEvaluationBudget();
+	SimplexSolver<3>  simplex;
+	GaussNewtonSolver gaussNewton;
+	Optimizer<3> *optimizer = &solver;
+	Optimizer<3> *polisher  = NULL;
+	if (mvs.optimizer == MVS::OPTIMIZER_PSO_SIMPLEX) {
+		simplex.reset(solver.getRangeL(), solver.getRangeU(), PAIS::getFitness, this, solver.getMaxIteration(), POLISH_STEP);
+		polisher = &simplex;
+	} else if (mvs.optimizer == MVS::OPTIMIZER_PSO_GAUSS_NEWTON) {
+		gaussNewton.reset(this, solver.getRangeL(), solver.getRangeU(), GAUSS_NEWTON_ITERATION);
+		polisher = &gaussNewton;
+	}
+
+	if (polisher != NULL && (budget <= 0 || evaluations < budget)) {
+		polisher->setFitnessBatch(PAIS::getFitnessBatch);
+		polisher->setInitialGuess(solver.getGbest());
+		polisher->setMaxEvaluations( (budget > 0) ? budget - evaluations : 0 );
+		polisher->optimize();
+		iteration   += polisher->getIteration();
+		evaluations += polisher->getEvaluations();
+		// polish stopped by budget before its first evaluation keeps gBest
+		if (polisher->getGbestFitness() <= solver.getGbestFitness()) optimizer = polisher;
+	}
+
+	setOptimizationResult(*optimizer, iteration, clock() - start_t);
+	if ( solver.getFitnessCache().isEnable() ) solver.getFitnessCache().addTotal();
+
+	homographyEngine.clear();
+}
+
+void Patch::setOptimizationResult(const Optimizer<3> &optimizer, const int iteration, const clock_t time) {
+	const MVS &mvs = MVS::getInstance();
 
 	// set refined patch information
-	fitness = solver->getGbestFitness();
-    const double *gBest = solver->getGbest();
-    setNormal(Vec2d(gBest[0], gBest[1]));
-    depth  = gBest[2];
+	fitness = optimizer.getGbestFitness();
+	const double *gBest = optimizer.getGbest();
+	setNormal(Vec2d(gBest[0], gBest[1]));
+	depth  = gBest[2];
 	center = ray * depth + mvs.getCamera(refCamIdx).getCenter();
 
 	if (type != TYPE_SEED)
-		LogManager::log("patch it\t%d\tsec\t%f", solver->getIteration(), (double)(end_t - start_t) / CLOCKS_PER_SEC);
+		LogManager::log("patch it\t%d\tsec\t%f", iteration, (double) time / CLOCKS_PER_SEC);
+}
 
-	delete solver;
+template <typename T>
+void Patch::homographyPatchTask(const int i, void *obj) {
+	const HomographyPatchLoop<T> &loop = *((HomographyPatchLoop<T> *) obj);
+	Patch &pth = *loop.patch;
+	const Mat_<uchar> &img = MVS::getInstance().cameras[pth.camIdx[i]].getPyramidImage(pth.LOD);
+	pth.getHomographyPatch(*loop.pt, img, (*loop.H)[i], loop.HP + i*loop.pixelNum);
 }
 
 void Patch::setCorrelationTable(const vector<Mat_<double>> &H) {
+	if ( MVS::getInstance().isSinglePrecisionEnable() ) {
+		setCorrelationTableT<float>(H);
+	} else {
+		setCorrelationTableT<double>(H);
+	}
+}
+
+template <typename T>
+void Patch::setCorrelationTableT(const vector<Mat_<double>> &H) {
 	const MVS &mvs = MVS::getInstance();
 	const vector<Camera> &cameras = mvs.cameras;
 
@@ -232,13 +498,12 @@ void Patch::setCorrelationTable(const vector<Mat_<double>> &H) {
 	Vec2d pt;
 	refCam.project(center, pt, LOD);
 
-	// get normalized homography patch column vector
-	vector<Mat_<double> > HP(camNum);
-	#pragma omp parallel for
-	for (int i = 0; i < camNum; i++) {
-		const Mat_<uchar> &img = cameras[camIdx[i]].getPyramidImage(LOD);
-		getHomographyPatch(pt, img, H[i], HP[i]);
-	}
+	// get normalized homography patch column vector (scratch memory of calling thread)
+	ScratchScope scratch;
+	const int pixelNum = mvs.patchSize*mvs.patchSize;
+	T *HP = scratch.alloc<T>(camNum*pixelNum);
+	HomographyPatchLoop<T> loop = {this, &pt, &H, HP, pixelNum};
+	TaskPool::parallelFor(camNum, homographyPatchTask<T>, &loop);
 
 	// drop patch if out of boundary
 	if (drop) {
@@ -250,8 +515,13 @@ void Patch::setCorrelationTable(const vector<Mat_<double>> &H) {
 	for (int i = 0; i < camNum; ++i) {
 		corrTable.at<double>(i, i) = 0;
 		for (int j = i+1; j < camNum; ++j) {
-			Mat_<double> corr = HP[i].t() * HP[j];
-			corrTable.at<double>(i, j) = corr.at<double>(0, 0);
+			const T *hpi = HP + i*pixelNum;
+			const T *hpj = HP + j*pixelNum;
+			double dot = 0;
+			for (int k = 0; k < pixelNum; ++k) {
+				dot += (double) hpi[k]*hpj[k];
+			}
+			corrTable.at<double>(i, j) = dot;
 			corrTable.at<double>(j, i) = corrTable.at<double>(i, j);
 		}
 	}
@@ -289,47 +559,28 @@ double Patch::getHomographyRegionRatio(const Vec2d &pt, const Mat_<double> &H) c
 
 void Patch::getHomographies(const Vec3d &center, const Vec3d &normal, vector<Mat_<double>> &H) const {
 	const MVS &mvs = MVS::getInstance();
-	const vector<Camera> &cameras = mvs.getCameras();
-
-	// camera parameters
-	const Camera &refCam  = mvs.getCamera(refCamIdx);
-	const Mat_<double> &KRF = refCam.getKR();
-	const Mat_<double> &KTF = refCam.getKT();
-
-	// plane equation (distance form plane to origin)
-	const double d = -center.ddot(normal);          
-	const Mat_<double> normalM(normal);
 
 	// set container
 	const int camNum = getCameraNumber();
 	H.resize(camNum);
 
-	// LOD scalar for camera intrisic matrix K
-	Mat_<double> LODM = Mat_<double>::zeros(3, 3);
-	LODM.at<double>(0, 0) = pow(mvs.lodRatio, LOD);
-	LODM.at<double>(1, 1) = pow(mvs.lodRatio, LOD);
-	LODM.at<double>(2, 2) = 1.0;
-
 	// get homography from reference to target image
-	Mat_<double> invH = ( d*LODM*KRF - LODM*KTF*normalM.t() ).inv();
+	HomographyEngine engine;
+	engine.setup(mvs.getCameras(), refCamIdx, camIdx, pow(mvs.lodRatio, LOD));
+	vector<Matx33d> HX(camNum);
+	engine.getHomographies(center, normal, &HX[0]);
 	for (int i = 0; i < camNum; i++) {
-		// indentity for reference camera
-		if (camIdx[i] == refCamIdx) {
-			H[i] = Mat_<double>::eye(3, 3);
-			continue;
+		H[i] = Mat_<double>(3, 3);
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				H[i].at<double>(r, c) = HX[i](r, c);
+			}
 		}
-
-		// visible camera
-		const Camera &cam = cameras[camIdx[i]];
-
-		// get homography matrix
-		const Mat_<double> &KRT = cam.getKR();        // K*R of to camera
-		const Mat_<double> &KTT = cam.getKT();        // K*T of to camera
-		H[i] = ( d*LODM*KRT - LODM*KTT*normalM.t() ) * invH;
 	}
 }
 
-void Patch::getHomographyPatch(const Vec2d &pt, const Mat_<uchar> &img, const Mat_<double> &H, Mat_<double> &hp) {
+template <typename T>
+void Patch::getHomographyPatch(const Vec2d &pt, const Mat_<uchar> &img, const Mat_<double> &H, T *hp) {
 
 	if (this->drop) return;
 
@@ -337,19 +588,30 @@ void Patch::getHomographyPatch(const Vec2d &pt, const Mat_<uchar> &img, const Ma
 	const int patchRadius = mvs.patchRadius;
 	const int patchSize   = mvs.patchSize;
 
-	hp = Mat_<double>(patchSize*patchSize, 1);
+	// homography in given precision
+	T h[9];
+	for (int j = 0; j < 9; ++j) {
+		h[j] = (T) H.at<double>(j/3, j%3);
+	}
 
-	double w, ix, iy;                // position on target image
+	T hx, hy, w, r, ix, iy;          // position on target image
 	int px[4];                       // neighbor x
 	int py[4];                       // neighbor y
 	int count = 0;
-	double sum = 0;
-	for (double x = pt[0]-patchRadius; x <= pt[0]+patchRadius; ++x) {
-		for (double y = pt[1]-patchRadius; y <= pt[1]+patchRadius; ++y) {
+	T sum = 0;
+	T x, y;
+	for (int ey = 0; ey < patchSize; ++ey) {
+		// homogeneous point of scanline start, stepped by first column of H
+		x  = (T) (pt[0]-patchRadius);
+		y  = (T) (pt[1]-patchRadius+ey);
+		hx = h[0] * x + h[1] * y + h[2];
+		hy = h[3] * x + h[4] * y + h[5];
+		w  = h[6] * x + h[7] * y + h[8];
+		for (int ex = 0; ex < patchSize; ++ex, hx += h[0], hy += h[3], w += h[6]) {
 			// homography projection (with LOD transform)
-			w  = ( H.at<double>(2, 0) * x + H.at<double>(2, 1) * y + H.at<double>(2, 2) );
-			ix = ( H.at<double>(0, 0) * x + H.at<double>(0, 1) * y + H.at<double>(0, 2) ) / w;
-			iy = ( H.at<double>(1, 0) * x + H.at<double>(1, 1) * y + H.at<double>(1, 2) ) / w;
+			r  = (T) 1 / w;
+			ix = hx * r;
+			iy = hy * r;
 
 			// skip overflow cases
 			if (ix < 0 || ix >= img.cols-1 || iy < 0 || iy >= img.rows-1 || w == 0 || this->drop) {
@@ -371,17 +633,20 @@ void Patch::getHomographyPatch(const Vec2d &pt, const Mat_<uchar> &img, const Ma
 			px[3] = px[0] + 1;
 			py[3] = py[0] + 1;
 
-			hp.at<double>(count, 0) = (double) img.at<uchar>(py[0], px[0])*(px[1]-ix)*(py[2]-iy) + 
-					                  (double) img.at<uchar>(py[1], px[1])*(ix-px[0])*(py[2]-iy) + 
-					                  (double) img.at<uchar>(py[2], px[2])*(px[1]-ix)*(iy-py[0]) + 
-					                  (double) img.at<uchar>(py[3], px[3])*(ix-px[0])*(iy-py[0]);
+			hp[count] = (T) img.at<uchar>(py[0], px[0])*(px[1]-ix)*(py[2]-iy) + 
+			            (T) img.at<uchar>(py[1], px[1])*(ix-px[0])*(py[2]-iy) + 
+			            (T) img.at<uchar>(py[2], px[2])*(px[1]-ix)*(iy-py[0]) + 
+			            (T) img.at<uchar>(py[3], px[3])*(ix-px[0])*(iy-py[0]);
 
-			sum += hp.at<double>(count, 0)*hp.at<double>(count, 0);
+			sum += hp[count]*hp[count];
 			++count;
 		}
 	}
 
-	hp /= sqrt(sum);
+	const T norm = sqrt(sum);
+	for (int i = 0; i < count; ++i) {
+		hp[i] /= norm;
+	}
 	return;
 }
 
@@ -534,7 +799,8 @@ void Patch::setLOD() {
     int count;
 
     // textures in window
-    uchar *textures = new uchar[size*size];
+	ScratchScope scratch;
+    uchar *textures = scratch.alloc<uchar>(size*size);
         
     // projected point on image
     Vec2d pt;
@@ -550,7 +816,6 @@ void Patch::setLOD() {
         // return if reach the max LOD
         if (LOD >= refCam.getMaxLOD()) {
 			LOD = refCam.getMaxLOD();
-            delete [] textures;
             return;
         }
 
@@ -558,7 +823,6 @@ void Patch::setLOD() {
         if ( !refCam.project(center, pt, LOD) ) {
             //printf("setLOD image point out of image bound: LOD %d, x: %f, y: %f\n", LOD, pt[0], pt[1]);
             LOD = max(LOD-1, 0);
-            delete [] textures;
             return;
         }
 
@@ -573,8 +837,7 @@ void Patch::setLOD() {
                 if ( !refCam.inImage(x, y, LOD) ) {
                     //printf("setLOD image point out of image bound: LOD %d, x: %d, y: %d\n", LOD, x, y);
                     LOD = max(LOD-1, 0);
-                    delete [] textures;
-                    return;
+                            return;
                 }
                 textures[count] = pyramid[LOD].at<uchar>(y, x);
                 mean += textures[count];
@@ -606,7 +869,6 @@ void Patch::setLOD() {
         destroyAllWindows();
     }
 	*/
-    delete [] textures;
 }
 
 void Patch::setPriority() {
@@ -911,7 +1173,36 @@ void Patch::showError() const {
 
 /* fitness function */
 
-double PAIS::getFitness(const Particle &p, void *obj) {
+// particle loop of batch fitness (subtask of patch refinement)
+template <typename T>
+struct FitnessBatchLoop {
+	const T *homographies;
+	const Vec2d *pts;
+	const char *valid;
+	const double *bounds;
+	double *fitness;
+	int *rows;
+	const Mat_<uchar> **imgs;
+	int camNum;
+	const Mat_<uchar> *refImg;
+	const Mat_<double> *edgeImg;
+	T *samples;
+	T *c;
+	int patchSize;
+};
+
+template <typename T>
+static void particleFitnessTask(const int k, void *obj) {
+	const FitnessBatchLoop<T> &loop = *((FitnessBatchLoop<T> *) obj);
+	if ( !loop.valid[k] ) return;
+	const int camNum    = loop.camNum;
+	const int patchSize = loop.patchSize;
+	const double bound  = (loop.bounds == NULL) ? DBL_MAX : loop.bounds[k];
+	loop.fitness[k] = FitnessKernel::evaluate(loop.homographies + k*camNum*9, loop.pts[k], bound, loop.imgs, camNum, *loop.refImg, *loop.edgeImg, loop.samples + k*camNum*patchSize, loop.c + k*camNum, loop.rows[k]);
+}
+
+template <typename T>
+static void getFitnessBatchT(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj) {
 	// MVS
 	const MVS &mvs                = MVS::getInstance();
 	const int patchRadius         = mvs.getPatchRadius();
@@ -925,123 +1216,107 @@ double PAIS::getFitness(const Particle &p, void *obj) {
 	// level of detail
 	int LOD = patch.getLOD();
 
-	// camera parameters
+	// camera parameters (shared by all particles)
 	const Camera &refCam        = mvs.getCamera(patch.getReferenceCameraIndex());
 	const int camNum            = patch.getCameraNumber();
 	const Mat_<double> &edgeImg = refCam.getPyramidEdge(LOD);
 	const Mat_<uchar>  &refImg  = refCam.getPyramidImage(LOD);
 
-	// given patch normal
-	Vec3d normal;
-	Utility::spherical2Normal(Vec2d(p.pos[0], p.pos[1]), normal);
-
-	// skip inversed normal
-	if (normal.ddot(refCam.getOpticalNormal()) > 0) {
-        return DBL_MAX;
-    }
-
-	// given patch center
-	const Vec3d center = patch.getRay() * p.pos[2] + refCam.getCenter();
-
-	// Homographies to visible camera
-	vector<Mat_<double> > H(camNum);
-	patch.getHomographies(center, normal, H);
-
-	// projected point on reference image with LOD transform
-	Vec2d pt;
-	if ( !refCam.project(center, pt, LOD) ) {
-		return DBL_MAX;
+	// scratch memory of calling thread
+	ScratchScope scratch;
+	const Mat_<uchar> **imgs = scratch.alloc<const Mat_<uchar>*>(camNum);
+	for (int i = 0; i < camNum; ++i) {
+		imgs[i] = &cameras[camIdx[i]].getPyramidImage(LOD);
 	}
 
-	// skip out of reference image bound patch
-	if (pt[0]-patchRadius < 2 || 
-		pt[0]+patchRadius >= edgeImg.cols-3 || 
-		pt[1]-patchRadius < 2 || 
-		pt[1]+patchRadius >= edgeImg.rows-3) {
-		return DBL_MAX;
+	// homography engine of pso optimization (otherwise set up for this call)
+	HomographyEngine localEngine;
+	const HomographyEngine *engine = &patch.getHomographyEngine();
+	if ( !engine->isReady() ) {
+		localEngine.setup(cameras, patch.getReferenceCameraIndex(), camIdx, pow(mvs.getLODRatio(), LOD));
+		engine = &localEngine;
 	}
 
-	// warping (get pixel-wised variance)
-	double mean, avgSad;             // pixel-wised mean, average sad
-	double w, ix, iy;                // position on target image
-	int px[4];                       // neighbor x
-	int py[4];                       // neighbor y
-	double *c = new double [camNum]; // bilinear color
-	double fitness = 0;              // result of normalized fitness
-
-	// distance & difference weighting weighting
-	const double diffWeighting = mvs.getDifferenceWeight();
-	const double gradientWeighting = mvs.getGradientWeight();
-	Mat_<double>::const_iterator it = mvs.getPatchDistanceWeighting().begin();
-	double weight;
-	double sumWeight = 0;
-
-	for (double x = pt[0]-patchRadius; x <= pt[0]+patchRadius; ++x) {
-		for (double y = pt[1]-patchRadius; y <= pt[1]+patchRadius; ++y, ++it) {
-			// clear
-			mean   = 0;
-			avgSad = 0;
-
-			// skip background
-			if (refImg.at<uchar>(cvRound(y), cvRound(x)) == 0) continue;
-			// skip no gradient
-			// if (edgeImg.at<double>(cvRound(y), cvRound(x)) == 0.0) continue;
-
-			for (int i = 0; i < camNum; ++i) {
-				const Mat_<uchar> &img = cameras[camIdx[i]].getPyramidImage(LOD);
-
-				// homography projection
-				w  = ( H[i].at<double>(2, 0) * x + H[i].at<double>(2, 1) * y + H[i].at<double>(2, 2) );
-				ix = ( H[i].at<double>(0, 0) * x + H[i].at<double>(0, 1) * y + H[i].at<double>(0, 2) ) / w;
-				iy = ( H[i].at<double>(1, 0) * x + H[i].at<double>(1, 1) * y + H[i].at<double>(1, 2) ) / w;
+	// homographies (particle-major, camera-minor) and projected point on reference image of each particle
+	T *homographies = scratch.alloc<T>(num*camNum*9);
+	Vec2d *pts      = scratch.construct<Vec2d>(num);
+	char  *valid    = scratch.alloc<char>(num);
+	Matx33d *H      = scratch.construct<Matx33d>(camNum);
+	Vec3d normal, center;
+	for (int k = 0; k < num; ++k) {
+		const double *p = pos[k];
+		fitness[k] = DBL_MAX;
+		valid[k]   = 0;
+
+		// given patch normal
+		Utility::spherical2Normal(Vec2d(p[0], p[1]), normal);
+
+		// skip inversed normal
+		if (normal.ddot(refCam.getOpticalNormal()) > 0) continue;
+
+		// given patch center
+		center = patch.getRay() * p[2] + refCam.getCenter();
+
+		// projected point on reference image with LOD transform
+		Vec2d &pt = pts[k];
+		if ( !refCam.project(center, pt, LOD) ) continue;
+
+		// skip out of reference image bound patch
+		if (pt[0]-patchRadius < 2 || 
+			pt[0]+patchRadius >= edgeImg.cols-3 || 
+			pt[1]-patchRadius < 2 || 
+			pt[1]+patchRadius >= edgeImg.rows-3) {
+			continue;
+		}
 
-				// skip overflow cases
-				if (ix < 2 || ix >= img.cols-3 || iy < 2 || iy >= img.rows-3 || w == 0) {
-					delete [] c;
-					return DBL_MAX;
-				}
-				
-				// interpolation neighbor points
-				px[0] = (int) ix;
-				py[0] = (int) iy;
-				px[1] = px[0] + 1;
-				py[1] = py[0];
-				px[2] = px[0];
-				py[2] = py[0] + 1;
-				px[3] = px[0] + 1;
-				py[3] = py[0] + 1;
-				
-				c[i] = (double) img.at<uchar>(py[0], px[0])*(px[1]-ix)*(py[2]-iy) + 
-					   (double) img.at<uchar>(py[1], px[1])*(ix-px[0])*(py[2]-iy) + 
-					   (double) img.at<uchar>(py[2], px[2])*(px[1]-ix)*(iy-py[0]) + 
-					   (double) img.at<uchar>(py[3], px[3])*(ix-px[0])*(iy-py[0]);
+		// Homographies to visible camera
+		engine->getHomographies(center, normal, H);
+		for (int i = 0; i < camNum; ++i) {
+			T *h = homographies + (k*camNum+i)*9;
+			for (int j = 0; j < 9; ++j) {
+				h[j] = (T) H[i](j/3, j%3);
+			}
+		}
 
-				mean += c[i];
-			} // end of camera
+		valid[k] = 1;
+	}
 
-			mean /= camNum;
+	// weighted average SAD of each particle (scanline samples and bilinear color per particle)
+	T *samples = scratch.alloc<T>(num*camNum*patchSize);
+	T *c       = scratch.alloc<T>(num*camNum);
+	int *rows  = scratch.alloc<int>(num);
+	FitnessBatchLoop<T> loop = {homographies, pts, valid, bounds, fitness, rows, imgs, camNum, &refImg, &edgeImg, samples, c, patchSize};
+	TaskPool::parallelFor(num, particleFitnessTask<T>, &loop);
+
+	// warped pixels of batch (one update per batch)
+	long long pixels = 0, fullPixels = 0;
+	for (int k = 0; k < num; ++k) {
+		if ( !valid[k] ) continue;
+		pixels     += rows[k];
+		fullPixels += patchSize;
+	}
+	FitnessKernel::addPixelCount(pixels * camNum * patchSize, fullPixels * camNum * patchSize);
+}
 
-			for (int i = 0; i < camNum; i++) {
-				avgSad += abs(c[i]-mean);
-			}
-			avgSad /= camNum;
+double PAIS::getFitness(const double *pos, void *obj) {
+	return getFitness(pos, obj, MVS::getInstance().isSinglePrecisionEnable());
+}
 
-			weight = 1;
-			if ( mvs.isAdaptiveDistanceEnable() ) {   // adaptive distance weighting
-				weight *= (*it);
-			}
-			if ( mvs.isAdaptiveDifferenceEnable() ) { // adaptive difference weighting
-				weight *= exp(-avgSad*avgSad/diffWeighting);
-			}
-			if ( mvs.isAdaptiveGradientEnable() ) {   // adaptive gradient maginitude weighting
-				weight *= exp( -1.0 / (edgeImg.at<double>(cvRound(y), cvRound(x))*gradientWeighting) );
-			}
-			sumWeight += weight;
-			fitness   += weight * avgSad;
-		} // end of warping y
-	} // end of warping x
+double PAIS::getFitness(const double *pos, void *obj, const bool singlePrecision) {
+	// single particle batch
+	double fitness;
+	getFitnessBatch(&pos, 1, NULL, &fitness, obj, singlePrecision);
+	return fitness;
+}
 
-	delete [] c;
+void PAIS::getFitnessBatch(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj) {
+	getFitnessBatch(pos, num, bounds, fitness, obj, MVS::getInstance().isSinglePrecisionEnable());
+}
 
-	return fitness / sumWeight;
+void PAIS::getFitnessBatch(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj, const bool singlePrecision) {
+	if (singlePrecision) {
+		getFitnessBatchT<float>(pos, num, bounds, fitness, obj);
+	} else {
+		getFitnessBatchT<double>(pos, num, bounds, fitness, obj);
+	}
 }
\ No newline at end of file
@@ -3,8 +3,16 @@
 
 #include "../io/logmanager.h"
 #include "../pso/psosolver.h"
+#include "../pso/solverpool.h"
+#include "../pso/simplexsolver.h"
+#include "gaussnewtonsolver.h"
 #include "abstractpatch.h"
 #include "mvs.h"
+#include "warpkernel.h"
+#include "homography.h"
+#include "fitnesskernel.h"
+#include "scratcharena.h"
+#include "taskpool.h"
 
 using namespace PAIS;
 using namespace cv;
@@ -18,14 +26,46 @@ namespace PAIS {
 		static const int TYPE_EXPAND = 0x1;
 		bool drop;
 		int type;
+		// homography engine in pso optimization
+		HomographyEngine homographyEngine;
+		// fitness evaluation number of last refinement
+		int evaluations;
+		// final swarm of last pso optimization (best pBest offsets from gBest in search range unit),
+		// inherited by expansion patches for warm start
+		vector<float> swarm;
 
 		void setCorrelationTable(const vector<Mat_<double>> &H);
-		// get homography texture 1D vector
-		void getHomographyPatch(const Vec2d &pt, const Mat_<uchar> &img, const Mat_<double> &H, Mat_<double> &hp);
+		// set correlation table in given precision (float, double)
+		template <typename T> void setCorrelationTableT(const vector<Mat_<double>> &H);
+		// get normalized homography texture 1D vector (hp: patch size * patch size)
+		template <typename T> void getHomographyPatch(const Vec2d &pt, const Mat_<uchar> &img, const Mat_<double> &H, T *hp);
+		// camera loop of correlation table (subtask of patch refinement)
+		template <typename T> struct HomographyPatchLoop {
+			Patch *patch;
+			const Vec2d *pt;
+			const vector<Mat_<double>> *H;
+			T *HP;
+			int pixelNum;
+		};
+		template <typename T> static void homographyPatchTask(const int i, void *obj);
 		// expand visible camera using normal correlation
 		void expandVisibleCamera();
-		// do pso optimization 
-		void psoOptimization();
+		// do optimization by config backend (pso solver is re-armed)
+		void psoOptimization(PsoSolver<3> &solver);
+		// set reference camera, depth and LOD before optimization (false: dropped)
+		bool beginRefinement();
+		// check fitness and update visible cameras after optimization (false: dropped)
+		bool updateRefinement();
+		// fitness evaluation budget of refinement, shared by its optimizations (0: unlimited)
+		int getEvaluationBudget() const;
+		// search range, initial guess and swarm size of optimization (theta, phi, depth)
+		void getSearchSpace(double *rangeL, double *rangeU, double *init, int &maxIteration, int &particleNum) const;
+		// re-arm pso solver for this patch (optional: warm start from parent swarm), returns start clock
+		clock_t armSwarm(PsoSolver<3> &solver);
+		// keep final swarm, polish gBest by config backend and set refined result
+		void finishSwarm(PsoSolver<3> &solver, const clock_t start_t);
+		// set refined center and normal from optimizer result
+		void setOptimizationResult(const Optimizer<3> &optimizer, const int iteration, const clock_t time);
 
 	protected:
 		void setEstimatedNormal();
@@ -48,10 +88,16 @@ namespace PAIS {
 
 		void reCentering();
 		void refine();
+		// refine sibling expansion patches with their swarms advanced in lockstep
+		static void refineLockstep(vector<Patch> &patches);
+		// release final swarm (after expansion)
+		void releaseSwarm();
 		void removeInvisibleCamera();
 
 		// get homographies
 		void getHomographies(const Vec3d &center, const Vec3d &normal, vector<Mat_<double>> &H) const;
+		// get homography engine (ready in pso optimization)
+		const HomographyEngine& getHomographyEngine() const { return homographyEngine; }
 		// get homography region ratio
 		double getHomographyRegionRatio(const Vec2d &pt, const Mat_<double> &H) const;
 		// show homography window in visible cameras
@@ -60,10 +106,19 @@ namespace PAIS {
 		void showError() const;
 		// is dropped
 		bool isDropped() const { return drop; }
+		// fitness evaluation number of last refinement
+		int getEvaluations() const { return evaluations; }
 		~Patch(void);
 	};
 
-	double getFitness(const Particle &p, void *obj);
+	// fitness function of position (theta, phi, depth)
+	double getFitness(const double *pos, void *obj);
+	// fitness function in given precision (true: float, false: double)
+	double getFitness(const double *pos, void *obj, const bool singlePrecision);
+	// fitness function of whole swarm (camera setup shared by particles)
+	// evaluation of particle k stops once its fitness must exceed bounds[k] (bounds: NULL for exact fitness)
+	void getFitnessBatch(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj);
+	void getFitnessBatch(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj, const bool singlePrecision);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include <new>
+#include <algorithm>
+
+#include "patchmap.h"
+#include "patch.h"
+
+using namespace PAIS;
+
+PatchMap::PatchMap(void) : deadIds(0), num(0) {
+
+}
+
+PatchMap::~PatchMap(void) {
+	clear();
+}
+
+Patch& PatchMap::insert(const Patch &pth) {
+	const int id = pth.getId();
+	Patch *stored = find(id);
+	if (stored != NULL) return *stored;
+
+	// reuse free slot, or open a new slot (new block every BLOCK_SIZE slots)
+	int slot;
+	if ( !freeSlots.empty() ) {
+		slot = freeSlots.back();
+	} else {
+		slot = (int) slots.size();
+		if (slot % BLOCK_SIZE == 0) {
+			blocks.push_back( (Patch*) ::operator new(sizeof(Patch) * BLOCK_SIZE) );
+		}
+	}
+	stored = new (blocks[slot / BLOCK_SIZE] + slot % BLOCK_SIZE) Patch(pth);
+
+	if ( !freeSlots.empty() ) {
+		freeSlots.pop_back();
+		slots[slot] = stored;
+	} else {
+		slots.push_back(stored);
+		generations.push_back(0);
+		slotIds.push_back(id);
+		centers.push_back(Vec3d());
+		normals.push_back(Vec3d());
+		priorities.push_back(0);
+		fitnesses.push_back(0);
+		correlations.push_back(0);
+		cameraNums.push_back(0);
+		flags.push_back(0);
+	}
+	if (id >= (int) index.size()) {
+		index.resize(id+1, -1);
+	}
+	index[id] = slot;
+	num++;
+	setHotData(slot);
+
+	// ascending id list (new id appends, dead entry of re-inserted id is revived)
+	if (ids.empty() || id > ids.back()) {
+		ids.push_back(id);
+	} else {
+		vector<int>::iterator pos = lower_bound(ids.begin(), ids.end(), id);
+		if (pos != ids.end() && *pos == id) {
+			deadIds--;
+		} else {
+			ids.insert(pos, id);
+		}
+	}
+
+	return *stored;
+}
+
+PatchMap::iterator PatchMap::erase(const int id) {
+	if ( !contains(id) ) return iterator(this, nextPos((int) ids.size(), id));
+
+	const int slot = index[id];
+	slots[slot]->~Patch();
+	slots[slot] = NULL;
+	flags[slot] = 0;
+	// outstanding handles of slot become stale
+	generations[slot]++;
+	freeSlots.push_back(slot);
+	index[id] = -1;
+	num--;
+
+	// id stays as dead entry, compact once dead entries outnumber stored patches
+	deadIds++;
+	if (deadIds > num) compactIds();
+
+	return iterator(this, nextPos((int) ids.size(), id));
+}
+
+int PatchMap::nextPos(const int pos, const int id) const {
+	if (pos < (int) ids.size() && ids[pos] == id) return livePos(pos+1);
+	// id list changed since pos was taken
+	return livePos( (int) (upper_bound(ids.begin(), ids.end(), id) - ids.begin()) );
+}
+
+void PatchMap::compactIds() {
+	int n = 0;
+	for (int i = 0; i < (int) ids.size(); ++i) {
+		if (index[ids[i]] >= 0) ids[n++] = ids[i];
+	}
+	ids.resize(n);
+	deadIds = 0;
+}
+
+void PatchMap::clear() {
+	for (int i = 0; i < (int) slots.size(); ++i) {
+		if (slots[i] != NULL) slots[i]->~Patch();
+	}
+	for (int i = 0; i < (int) blocks.size(); ++i) {
+		::operator delete(blocks[i]);
+	}
+	blocks.clear();
+	slots.clear();
+	generations.clear();
+	freeSlots.clear();
+	slotIds.clear();
+	centers.clear();
+	normals.clear();
+	priorities.clear();
+	fitnesses.clear();
+	correlations.clear();
+	cameraNums.clear();
+	flags.clear();
+	index.clear();
+	ids.clear();
+	deadIds = 0;
+	num = 0;
+}
+
+PatchMap::Handle PatchMap::getHandle(const int id) const {
+	Handle handle;
+	handle.slot       = contains(id) ? index[id] : -1;
+	handle.generation = handle.slot >= 0 ? generations[handle.slot] : 0;
+	return handle;
+}
+void PatchMap::update(const int id) {
+	const int slot = getSlot(id);
+	if (slot >= 0) setHotData(slot);
+}
+
+void PatchMap::setHotData(const int slot) {
+	const Patch &pth = *slots[slot];
+	slotIds[slot]      = pth.getId();
+	centers[slot]      = pth.getCenter();
+	normals[slot]      = pth.getNormal();
+	priorities[slot]   = pth.getPriority();
+	fitnesses[slot]    = pth.getFitness();
+	correlations[slot] = pth.getCorrelation();
+	cameraNums[slot]   = pth.getCameraNumber();
+	flags[slot]        = FLAG_STORED | (pth.isExpanded() ? FLAG_EXPANDED : 0);
+}
+
+bool PatchMap::isNeighbor(const int slot1, const int slot2, const double radius) const {
+	const Vec3d d = centers[slot1] - centers[slot2];
+
+	double dist = 0;
+	dist += abs(d.ddot(normals[slot1]));
+	dist += abs(d.ddot(normals[slot2]));
+
+	return dist <= radius;
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+#ifndef __PAIS_PATCH_MAP_H__
+#define __PAIS_PATCH_MAP_H__
+
+#include <stddef.h>
+#include <vector>
+#include <opencv2\opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace PAIS {
+	class Patch;
+
+	/*
+		patch container (id, patch) of generational slots
+
+		patches are stored in blocks of contiguous slots, patch address is kept while
+		it is stored (expansion holds parent reference during insertion). Erased slots
+		are reused from free list. Patch id to slot is an array lookup, and handle
+		(slot, generation) detects patch erased or slot reused since it was taken.
+		Iteration follows ascending patch id, so output files keep their order.
+
+		iteration walks a dense ascending list of stored ids, so begin/++ cost
+		O(stored patches) per pass instead of O(max id). New ids mostly append at
+		the end. Erased ids stay in the list as dead entries and are compacted
+		once they outnumber stored patches. The id to slot array is kept for O(1)
+		find, at the cost of one int per id ever issued.
+
+		hot data of each slot (center, normal, priority, fitness, correlation, camera
+		number, flags) is kept as parallel arrays, so full scans of filtering and
+		bounding volume do not touch cold patch data (cameras, image points,
+		correlation table). Hot data is copied on insert, patch changed in place is
+		refreshed by update.
+	*/
+	class PatchMap {
+	public:
+		// stable reference of stored patch
+		struct Handle {
+			int slot;
+			unsigned int generation;
+		};
+
+		// ascending patch id iterator (position in id list, re-found by id if list was compacted)
+		class iterator {
+		private:
+			friend class PatchMap;
+			const PatchMap *map;
+			int pos;
+			int id;
+			iterator(const PatchMap *map, const int pos) : map(map), pos(pos), id(map->getListId(pos)) {}
+		public:
+			iterator(void) : map(NULL), pos(0), id(-1) {}
+			Patch& operator*()  const { return *map->slots[map->index[id]]; }
+			Patch* operator->() const { return  map->slots[map->index[id]]; }
+			iterator& operator++() { pos = map->nextPos(pos, id); id = map->getListId(pos); return *this; }
+			int getId()   const { return id; }
+			int getSlot() const { return map->index[id]; }
+			bool operator==(const iterator &it) const { return id == it.id; }
+			bool operator!=(const iterator &it) const { return id != it.id; }
+		};
+
+		class const_iterator {
+		private:
+			friend class PatchMap;
+			const PatchMap *map;
+			int pos;
+			int id;
+			const_iterator(const PatchMap *map, const int pos) : map(map), pos(pos), id(map->getListId(pos)) {}
+		public:
+			const_iterator(void) : map(NULL), pos(0), id(-1) {}
+			const_iterator(const iterator &it) : map(it.map), pos(it.pos), id(it.id) {}
+			const Patch& operator*()  const { return *map->slots[map->index[id]]; }
+			const Patch* operator->() const { return  map->slots[map->index[id]]; }
+			const_iterator& operator++() { pos = map->nextPos(pos, id); id = map->getListId(pos); return *this; }
+			int getId()   const { return id; }
+			int getSlot() const { return map->index[id]; }
+			bool operator==(const const_iterator &it) const { return id == it.id; }
+			bool operator!=(const const_iterator &it) const { return id != it.id; }
+		};
+
+	private:
+		// slots of each storage block
+		static const int BLOCK_SIZE = 1024;
+
+		// slot flags
+		static const unsigned char FLAG_STORED   = 0x01;
+		static const unsigned char FLAG_EXPANDED = 0x02;
+
+		// storage blocks (BLOCK_SIZE slots each)
+		vector<Patch*> blocks;
+		// patch of each slot (NULL: free slot)
+		vector<Patch*> slots;
+		// generation of each slot (increased when erased)
+		vector<unsigned int> generations;
+		// free slots (last freed first)
+		vector<int> freeSlots;
+		// slot of each patch id (-1: not stored)
+		vector<int> index;
+		// ascending ids of stored patches (and dead entries of erased ids)
+		vector<int> ids;
+		// dead entries in ids
+		int deadIds;
+		// stored patch number
+		int num;
+
+		// hot data of each slot (valid for stored slot)
+		vector<int>           slotIds;
+		vector<Vec3d>         centers;
+		vector<Vec3d>         normals;
+		vector<double>        priorities;
+		vector<double>        fitnesses;
+		vector<double>        correlations;
+		vector<int>           cameraNums;
+		vector<unsigned char> flags;
+
+		// copy hot data of stored patch into its slot
+		void setHotData(const int slot);
+
+		// not copyable (owns storage blocks)
+		PatchMap(const PatchMap &map);
+		PatchMap& operator=(const PatchMap &map);
+
+		// first stored id position from list position pos (ids size: end)
+		int livePos(int pos) const {
+			while (pos < (int) ids.size() && index[ids[pos]] < 0) ++pos;
+			return pos;
+		}
+		// first stored id position after id, pos is its last known position
+		int nextPos(const int pos, const int id) const;
+		// id of list position (-1: end)
+		int getListId(const int pos) const { return (pos < (int) ids.size()) ? ids[pos] : -1; }
+		// drop dead entries of id list
+		void compactIds();
+
+	public:
+		PatchMap(void);
+		~PatchMap(void);
+
+		// insert copy of patch (stored patch of same id is kept), returns stored patch
+		Patch& insert(const Patch &pth);
+		// erase patch by id and return iterator of next stored id
+		iterator erase(const int id);
+		iterator erase(const iterator &it) { return erase(it.id); }
+		// erase all patches and release storage (handles taken before are not valid)
+		void clear();
+
+		// refresh hot data of stored patch changed in place (refinement, re-centering, expanded)
+		void update(const int id);
+
+		// stored patch of id (NULL: not stored)
+		Patch* find(const int id) {
+			return (id >= 0 && id < (int) index.size() && index[id] >= 0) ? slots[index[id]] : NULL;
+		}
+		const Patch* find(const int id) const {
+			return (id >= 0 && id < (int) index.size() && index[id] >= 0) ? slots[index[id]] : NULL;
+		}
+		bool contains(const int id) const { return find(id) != NULL; }
+
+		// handle of stored patch (slot -1: not stored)
+		Handle getHandle(const int id) const;
+		// patch of handle (NULL: erased since handle was taken)
+		Patch* get(const Handle &handle) {
+			return isValid(handle) ? slots[handle.slot] : NULL;
+		}
+		const Patch* get(const Handle &handle) const {
+			return isValid(handle) ? slots[handle.slot] : NULL;
+		}
+		bool isValid(const Handle &handle) const {
+			return handle.slot >= 0 && handle.slot < (int) slots.size() &&
+				   generations[handle.slot] == handle.generation && slots[handle.slot] != NULL;
+		}
+
+		iterator       begin()       { return iterator(this, livePos(0)); }
+		iterator       end()         { return iterator(this, (int) ids.size()); }
+		const_iterator begin() const { return const_iterator(this, livePos(0)); }
+		const_iterator end()   const { return const_iterator(this, (int) ids.size()); }
+
+		int  size()  const { return num; }
+		bool empty() const { return num == 0; }
+
+		/* hot data by slot (slot scan: 0 <= slot < getSlotNumber(), skip unstored slot) */
+		// slot of patch id (-1: not stored)
+		int getSlot(const int id) const { return (id >= 0 && id < (int) index.size()) ? index[id] : -1; }
+		int getSlotNumber()                     const { return (int) slots.size();                   }
+		bool isStored(const int slot)           const { return (flags[slot] & FLAG_STORED)   != 0;   }
+		bool isExpanded(const int slot)         const { return (flags[slot] & FLAG_EXPANDED) != 0;   }
+		int getSlotId(const int slot)           const { return slotIds[slot];                        }
+		const Vec3d& getCenter(const int slot)  const { return centers[slot];                        }
+		const Vec3d& getNormal(const int slot)  const { return normals[slot];                        }
+		double getPriority(const int slot)      const { return priorities[slot];                     }
+		double getFitness(const int slot)       const { return fitnesses[slot];                      }
+		double getCorrelation(const int slot)   const { return correlations[slot];                   }
+		int getCameraNumber(const int slot)     const { return cameraNums[slot];                     }
+		// neighbor test of Patch::isNeighbor on hot data of two stored slots
+		bool isNeighbor(const int slot1, const int slot2, const double radius) const;
+	};
+};
+
+#endif
\ No newline at end of file
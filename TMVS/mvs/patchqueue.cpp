@@ -0,0 +1,176 @@
+#include "patchqueue.h"
+
+using namespace PAIS;
+
+PatchQueue::PatchQueue(const int order) {
+	clear(order);
+}
+
+PatchQueue::~PatchQueue(void) {
+
+}
+
+void PatchQueue::clear(const int order) {
+	this->order = order;
+	this->num   = 0;
+	this->seq   = 0;
+	heap.clear();
+	heapPos.clear();
+	entries.clear();
+	stamp.clear();
+}
+
+void PatchQueue::reserveId(const int id) {
+	if (id < (int) heapPos.size()) return;
+	const int size = max(id + 1, (int) heapPos.size() * 2);
+	heapPos.resize(size, -1);
+	stamp.resize(size, -1);
+}
+
+bool PatchQueue::contains(const int id) const {
+	if (id < 0 || id >= (int) heapPos.size()) return false;
+	return isHeap() ? heapPos[id] >= 0 : stamp[id] >= 0;
+}
+
+void PatchQueue::push(const int id, const double priority) {
+	if (id < 0) return;
+	if ( update(id, priority) ) return;
+	reserveId(id);
+
+	if ( isHeap() ) {
+		HeapNode node;
+		node.priority = priority;
+		node.seq      = seq++;
+		node.id       = id;
+		heap.push_back(node);
+		heapPos[id] = (int) heap.size() - 1;
+		siftUp((int) heap.size() - 1);
+	} else {
+		DequeNode node;
+		node.id  = id;
+		node.seq = seq++;
+		entries.push_back(node);
+		stamp[id] = node.seq;
+	}
+	num++;
+}
+
+bool PatchQueue::update(const int id, const double priority) {
+	if ( !contains(id) ) return false;
+	// FIFO / LIFO order ignores priority
+	if ( !isHeap() ) return true;
+
+	const int i = heapPos[id];
+	const double old = heap[i].priority;
+	heap[i].priority = priority;
+	if (priority == old) return true;
+
+	// decrease-key (toward top) or increase-key
+	HeapNode moved = heap[i];
+	moved.priority = old;
+	if ( before(heap[i], moved) ) {
+		siftUp(i);
+	} else {
+		siftDown(i);
+	}
+	return true;
+}
+
+bool PatchQueue::remove(const int id) {
+	if ( !contains(id) ) return false;
+
+	if ( isHeap() ) {
+		removeAt(heapPos[id]);
+	} else {
+		// lazy invalidation, entry is skipped on pop
+		stamp[id] = -1;
+	}
+	num--;
+	return true;
+}
+
+int PatchQueue::pop() {
+	if (num == 0) return -1;
+
+	if ( isHeap() ) {
+		const int id = heap[0].id;
+		removeAt(0);
+		num--;
+		return id;
+	}
+
+	// skip invalidated entries
+	while ( !entries.empty() ) {
+		DequeNode node;
+		if (order == ORDER_FIFO) {
+			node = entries.front();
+			entries.pop_front();
+		} else {
+			node = entries.back();
+			entries.pop_back();
+		}
+		if (stamp[node.id] != node.seq) continue;
+
+		stamp[node.id] = -1;
+		num--;
+		return node.id;
+	}
+	return -1;
+}
+
+bool PatchQueue::before(const HeapNode &a, const HeapNode &b) const {
+	if (a.priority != b.priority) {
+		return (order == ORDER_MIN_PRIORITY) ? (a.priority < b.priority) : (a.priority > b.priority);
+	}
+	return a.seq < b.seq;
+}
+
+void PatchQueue::setNode(const int i, const HeapNode &node) {
+	heap[i] = node;
+	heapPos[node.id] = i;
+}
+
+void PatchQueue::siftUp(int i) {
+	const HeapNode node = heap[i];
+	while (i > 0) {
+		const int parent = (i - 1) / 2;
+		if ( !before(node, heap[parent]) ) break;
+		setNode(i, heap[parent]);
+		i = parent;
+	}
+	setNode(i, node);
+}
+
+void PatchQueue::siftDown(int i) {
+	const int n = (int) heap.size();
+	const HeapNode node = heap[i];
+	while (true) {
+		int child = 2*i + 1;
+		if (child >= n) break;
+		if (child + 1 < n && before(heap[child+1], heap[child])) child++;
+		if ( !before(heap[child], node) ) break;
+		setNode(i, heap[child]);
+		i = child;
+	}
+	setNode(i, node);
+}
+
+void PatchQueue::removeAt(const int i) {
+	heapPos[heap[i].id] = -1;
+
+	const int last = (int) heap.size() - 1;
+	if (i == last) {
+		heap.pop_back();
+		return;
+	}
+
+	// move last node into hole and restore heap order
+	const HeapNode node = heap[last];
+	heap.pop_back();
+	setNode(i, node);
+	if (i > 0 && before(node, heap[(i - 1) / 2])) {
+		siftUp(i);
+	} else {
+		siftDown(i);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef __PAIS_PATCH_QUEUE_H__
+#define __PAIS_PATCH_QUEUE_H__
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+using namespace std;
+
+namespace PAIS {
+	/*
+		expansion queue of patch id
+
+		priority orders are an indexed binary heap (heap position of each patch id),
+		push, pop, priority update and removal are O(log n). FIFO and LIFO orders are
+		a deque, removed entries are invalidated by stamp and skipped on pop.
+		Equal priorities pop in insertion order.
+	*/
+	class PatchQueue {
+	public:
+		static const int ORDER_MIN_PRIORITY = 0x00; // smallest priority first
+		static const int ORDER_MAX_PRIORITY = 0x01; // largest priority first
+		static const int ORDER_FIFO         = 0x02; // first in first out
+		static const int ORDER_LIFO         = 0x03; // last in first out
+
+	private:
+		struct HeapNode {
+			double priority;
+			// insertion order (tie break)
+			long long seq;
+			int id;
+		};
+		struct DequeNode {
+			int id;
+			long long seq;
+		};
+
+		int order;
+		// live entry number
+		int num;
+		// insertion counter
+		long long seq;
+
+		// priority heap (priority orders)
+		vector<HeapNode> heap;
+		// heap position of patch id (-1: not queued)
+		vector<int> heapPos;
+
+		// FIFO / LIFO entries (may hold invalidated entries)
+		deque<DequeNode> entries;
+		// insertion stamp of queued patch id (-1: not queued)
+		vector<long long> stamp;
+
+		// node a pops before node b
+		bool before(const HeapNode &a, const HeapNode &b) const;
+		void siftUp(int i);
+		void siftDown(int i);
+		void setNode(const int i, const HeapNode &node);
+		void removeAt(const int i);
+		// grow id index to hold id
+		void reserveId(const int id);
+		bool isHeap() const { return order == ORDER_MIN_PRIORITY || order == ORDER_MAX_PRIORITY; }
+
+	public:
+		PatchQueue(const int order = ORDER_MIN_PRIORITY);
+		~PatchQueue(void);
+
+		// remove all entries and set order
+		void clear(const int order);
+		void clear() { clear(order); }
+
+		// push patch id (queued id: priority update)
+		void push(const int id, const double priority);
+		// update priority of queued patch id (false: not queued)
+		bool update(const int id, const double priority);
+		// remove patch id (false: not queued)
+		bool remove(const int id);
+		// pop next patch id (-1: empty)
+		int pop();
+
+		bool contains(const int id) const;
+		bool empty() const { return num == 0; }
+		int  size()  const { return num; }
+		int  getOrder() const { return order; }
+	};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include <algorithm>
+
+#include "scratcharena.h"
+
+using namespace PAIS;
+
+size_t ScratchArena::defaultBlockSize = 1 << 20;
+
+static PAIS_THREAD_LOCAL ScratchArena *threadArena = NULL;
+
+ScratchArena::ScratchArena(const size_t blockSize) {
+	block  = -1;
+	offset = 0;
+	addBlock(0, blockSize);
+}
+
+ScratchArena::~ScratchArena(void) {
+	for (size_t i = 0; i < raws.size(); ++i) {
+		delete [] raws[i];
+	}
+}
+
+ScratchArena& ScratchArena::getThreadArena() {
+	// arena lives as long as the thread (openMP threads are pooled)
+	if (threadArena == NULL) {
+		threadArena = new ScratchArena(defaultBlockSize);
+	}
+	return *threadArena;
+}
+
+void ScratchArena::setBlockSize(const size_t bytes) {
+	defaultBlockSize = bytes;
+}
+
+void ScratchArena::addBlock(const int idx, const size_t bytes) {
+	char *raw     = new char [bytes + ALIGNMENT];
+	char *aligned = raw + (ALIGNMENT - ((size_t) raw % ALIGNMENT)) % ALIGNMENT;
+	raws.insert(raws.begin() + idx, raw);
+	blocks.insert(blocks.begin() + idx, aligned);
+	blockSizes.insert(blockSizes.begin() + idx, bytes);
+}
+
+void* ScratchArena::allocBytes(const size_t bytes) {
+	// current block
+	if (block >= 0) {
+		const size_t start = (offset + ALIGNMENT-1) & ~(ALIGNMENT-1);
+		if (start + bytes <= blockSizes[block]) {
+			offset = start + bytes;
+			return blocks[block] + start;
+		}
+	}
+
+	// next block (append a large enough block once)
+	++block;
+	if (block >= (int) blocks.size() || blockSizes[block] < bytes) {
+		addBlock(block, max(bytes, defaultBlockSize));
+	}
+	offset = bytes;
+	return blocks[block];
+}
+
+ScratchArena::Marker ScratchArena::getMarker() const {
+	Marker marker;
+	marker.block  = block;
+	marker.offset = offset;
+	return marker;
+}
+
+void ScratchArena::release(const Marker &marker) {
+	block  = marker.block;
+	offset = marker.offset;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef __PAIS_SCRATCH_ARENA_H__
+#define __PAIS_SCRATCH_ARENA_H__
+
+#include <vector>
+#include <new>
+
+#include "utility.h"
+
+using namespace std;
+
+namespace PAIS {
+	/*
+		per-thread bump allocator of refinement scratch memory
+
+		each thread owns an arena of memory blocks which are kept for reuse,
+		so scratch memory of fitness evaluation, correlation table and LOD
+		does not touch the heap in steady state. Block size is set from MVS
+		config, a larger request appends a block once.
+	*/
+	class ScratchArena {
+	public:
+		// arena state for release
+		struct Marker {
+			int    block;
+			size_t offset;
+		};
+
+	private:
+		// memory blocks (raw, 32 bytes aligned, size)
+		vector<char*>  raws;
+		vector<char*>  blocks;
+		vector<size_t> blockSizes;
+		// current block and offset
+		int    block;
+		size_t offset;
+
+		// block size of new arena
+		static size_t defaultBlockSize;
+
+		ScratchArena(const size_t blockSize);
+		~ScratchArena(void);
+
+		void* allocBytes(const size_t bytes);
+		void  addBlock(const int idx, const size_t bytes);
+
+	public:
+		static const size_t ALIGNMENT = 32;
+
+		// arena of calling thread
+		static ScratchArena& getThreadArena();
+		// set block size of new arenas
+		static void setBlockSize(const size_t bytes);
+
+		// uninitialized array (POD)
+		template <typename T> T* alloc(const size_t n) {
+			return (T*) allocBytes(n*sizeof(T));
+		}
+		// default constructed array (trivially destructible type)
+		template <typename T> T* construct(const size_t n) {
+			T *p = alloc<T>(n);
+			for (size_t i = 0; i < n; ++i) {
+				new (p+i) T();
+			}
+			return p;
+		}
+
+		Marker getMarker() const;
+		void release(const Marker &marker);
+	};
+
+	// scratch memory of calling thread released at end of scope
+	class ScratchScope {
+	private:
+		ScratchArena &arena;
+		ScratchArena::Marker marker;
+
+		ScratchScope(const ScratchScope &);
+		ScratchScope& operator=(const ScratchScope &);
+
+	public:
+		ScratchScope(void) : arena(ScratchArena::getThreadArena()), marker(arena.getMarker()) {}
+		~ScratchScope(void) { arena.release(marker); }
+
+		template <typename T> T* alloc(const size_t n)     { return arena.alloc<T>(n);     }
+		template <typename T> T* construct(const size_t n) { return arena.construct<T>(n); }
+	};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,255 @@
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#elif defined(__linux__)
+	#include <sched.h>
+#endif
+#include <stdio.h>
+
+#include "taskpool.h"
+#include "../io/logmanager.h"
+
+using namespace PAIS;
+
+// processor affinity of thread
+#ifdef _WIN32
+	typedef DWORD_PTR AffinityMask;
+#elif defined(__linux__)
+	typedef cpu_set_t AffinityMask;
+#else
+	typedef int AffinityMask;
+#endif
+
+// unfinished units counter of a batch (OpenMP 2.0 has no atomic read, interlocked operations instead)
+static inline void decrementPending(volatile long *pending) {
+#ifdef _WIN32
+	InterlockedDecrement(pending);
+#else
+	__sync_sub_and_fetch(pending, 1);
+#endif
+}
+
+static inline long loadPending(volatile long *pending) {
+#ifdef _WIN32
+	return InterlockedCompareExchange(pending, 0, 0);
+#else
+	return __sync_fetch_and_add(pending, 0);
+#endif
+}
+
+// pin calling thread to processor of worker w, keep previous affinity (false: not pinned)
+static bool pinThread(const int w, AffinityMask &previous) {
+#ifdef _WIN32
+	previous = SetThreadAffinityMask(GetCurrentThread(), ((DWORD_PTR) 1) << (w % (sizeof(DWORD_PTR)*8)));
+	return previous != 0;
+#elif defined(__linux__)
+	if (sched_getaffinity(0, sizeof(AffinityMask), &previous) != 0) return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(w % omp_get_num_procs(), &set);
+	return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+// restore affinity of calling thread
+static void restoreThread(const AffinityMask &previous) {
+#ifdef _WIN32
+	SetThreadAffinityMask(GetCurrentThread(), previous);
+#elif defined(__linux__)
+	sched_setaffinity(0, sizeof(AffinityMask), &previous);
+#endif
+}
+
+vector<TaskPool::Worker*> TaskPool::workers;
+bool   TaskPool::affinity      = false;
+bool   TaskPool::subtaskEnable = true;
+double TaskPool::wallTime      = 0;
+PAIS_THREAD_LOCAL int TaskPool::workerIdx = -1;
+
+void TaskPool::setup(const int threadNum, const bool affinity, const bool subtaskEnable) {
+	const int num = (threadNum > 0) ? threadNum : omp_get_num_procs();
+
+	if (num != (int) workers.size()) {
+		for (int i = 0; i < (int) workers.size(); i++) {
+			omp_destroy_lock(&workers[i]->lock);
+			delete workers[i];
+		}
+		workers.resize(num);
+		for (int i = 0; i < num; i++) {
+			workers[i] = new Worker();
+			omp_init_lock(&workers[i]->lock);
+		}
+	}
+
+	TaskPool::affinity      = affinity;
+	TaskPool::subtaskEnable = subtaskEnable;
+	clearStatistics();
+}
+
+void TaskPool::pushTask(const int w, const Task &task) {
+	Worker &worker = *workers[w];
+	omp_set_lock(&worker.lock);
+	worker.tasks.push_back(task);
+	omp_unset_lock(&worker.lock);
+}
+
+bool TaskPool::getTask(const int w, Task &task) {
+	const int num = (int) workers.size();
+
+	// own newest task (cache warm)
+	Worker &worker = *workers[w];
+	omp_set_lock(&worker.lock);
+	if ( !worker.tasks.empty() ) {
+		task = worker.tasks.back();
+		worker.tasks.pop_back();
+		omp_unset_lock(&worker.lock);
+		return true;
+	}
+	omp_unset_lock(&worker.lock);
+
+	// steal oldest task of next workers
+	for (int k = 1; k < num; k++) {
+		Worker &victim = *workers[(w + k) % num];
+		omp_set_lock(&victim.lock);
+		if ( !victim.tasks.empty() ) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			omp_unset_lock(&victim.lock);
+			worker.stolen++;
+			return true;
+		}
+		omp_unset_lock(&victim.lock);
+	}
+	return false;
+}
+
+bool TaskPool::getBatchTask(const int w, volatile long *pending, Task &task) {
+	// subtasks of a batch are the newest tasks of own deque until popped or stolen
+	Worker &worker = *workers[w];
+	omp_set_lock(&worker.lock);
+	if ( !worker.tasks.empty() && worker.tasks.back().pending == pending ) {
+		task = worker.tasks.back();
+		worker.tasks.pop_back();
+		omp_unset_lock(&worker.lock);
+		return true;
+	}
+	omp_unset_lock(&worker.lock);
+	return false;
+}
+
+void TaskPool::execute(const int w, const Task &task) {
+	task.func(task.idx, task.obj);
+	workers[w]->executed++;
+
+	decrementPending(task.pending);
+}
+
+void TaskPool::run(const int num, TaskFunction func, void *obj) {
+	if (num <= 0) return;
+
+	// batch inside a task is a subtask loop
+	if (workerIdx >= 0) {
+		parallelFor(num, func, obj);
+		return;
+	}
+
+	if ( workers.empty() ) setup(0, affinity, subtaskEnable);
+	const int threadNum = (int) workers.size();
+
+	// units dealt round robin, idle workers steal
+	volatile long pending = num;
+	for (int i = 0; i < num; i++) {
+		Task task;
+		task.func    = func;
+		task.obj     = obj;
+		task.idx     = i;
+		task.pending = &pending;
+		pushTask(i % threadNum, task);
+	}
+
+	const double start = omp_get_wtime();
+	#pragma omp parallel num_threads(threadNum)
+	{
+		// team may be smaller than pool, tasks of absent workers are stolen
+		const int w = omp_get_thread_num();
+		workerIdx = w;
+		// pinning ends with the batch (master and OpenMP threads are reused by other parallel regions)
+		AffinityMask previous;
+		const bool pinned = affinity && pinThread(w, previous);
+
+		Task task;
+		while (true) {
+			if ( getTask(w, task) ) {
+				const double t = omp_get_wtime();
+				execute(w, task);
+				workers[w]->busyTime += omp_get_wtime() - t;
+				continue;
+			}
+
+			if (loadPending(&pending) <= 0) break;
+		}
+		if (pinned) restoreThread(previous);
+		workerIdx = -1;
+	}
+	wallTime += omp_get_wtime() - start;
+}
+
+void TaskPool::parallelFor(const int num, TaskFunction func, void *obj) {
+	const int w = workerIdx;
+
+	// outside pool: OpenMP loop
+	if (w < 0) {
+		#pragma omp parallel for
+		for (int i = 0; i < num; i++) {
+			func(i, obj);
+		}
+		return;
+	}
+
+	// inside task without subtasks: serial loop
+	if ( !subtaskEnable || num <= 1 || workers.size() <= 1 ) {
+		for (int i = 0; i < num; i++) {
+			func(i, obj);
+		}
+		return;
+	}
+
+	// subtasks on own deque (last iteration first), help with them until all are done
+	// (stolen subtasks finish on their thieves, nesting depth is that of parallelFor calls)
+	volatile long pending = num;
+	for (int i = num-1; i >= 0; i--) {
+		Task task;
+		task.func    = func;
+		task.obj     = obj;
+		task.idx     = i;
+		task.pending = &pending;
+		pushTask(w, task);
+	}
+
+	Task task;
+	while (true) {
+		if (loadPending(&pending) <= 0) break;
+		if ( getBatchTask(w, &pending, task) ) execute(w, task);
+	}
+}
+
+void TaskPool::clearStatistics() {
+	for (int i = 0; i < (int) workers.size(); i++) {
+		workers[i]->executed = 0;
+		workers[i]->stolen   = 0;
+		workers[i]->busyTime = 0;
+	}
+	wallTime = 0;
+}
+
+void TaskPool::printStatistics() {
+	printf("task pool: %d workers, wall time %f sec\n", (int) workers.size(), wallTime);
+	for (int i = 0; i < (int) workers.size(); i++) {
+		const Worker &worker = *workers[i];
+		const double utilization = (wallTime > 0) ? worker.busyTime / wallTime : 0.0;
+		printf("worker %d:\ttasks %lld\tstolen %lld\tbusy %f sec\tutilization %f\n", i, worker.executed, worker.stolen, worker.busyTime, utilization);
+		LogManager::log("worker\t%d\ttasks\t%lld\tstolen\t%lld\tbusy\t%f\tutilization\t%f", i, worker.executed, worker.stolen, worker.busyTime, utilization);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef __PAIS_TASK_POOL_H__
+#define __PAIS_TASK_POOL_H__
+
+#include <vector>
+#include <deque>
+
+// include openMP
+#include <omp.h>
+
+#include "scratcharena.h"
+
+using namespace std;
+
+namespace PAIS {
+	// work unit function (index of unit, bundled object)
+	typedef void (*TaskFunction)(const int idx, void *obj);
+
+	/*
+		work-stealing task pool on OpenMP threads
+
+		each worker owns a deque of tasks, it pops its own newest task and steals
+		the oldest task of another worker when empty. run() executes a batch of
+		work units (patch refinement) on the workers, parallelFor() called inside
+		a task pushes its iterations as subtasks and helps with its own subtasks
+		only (no unrelated task nests on its stack) until they are done, outside
+		the pool it is a plain OpenMP loop.
+	*/
+	class TaskPool {
+	private:
+		struct Task {
+			TaskFunction func;
+			void *obj;
+			int idx;
+			// unfinished units of owner batch (atomic counter)
+			volatile long *pending;
+		};
+
+		struct Worker {
+			deque<Task> tasks;
+			omp_lock_t  lock;
+			// statistics
+			long long executed;
+			long long stolen;
+			double    busyTime;
+		};
+
+		// workers (thread number of pool)
+		static vector<Worker*> workers;
+		// pin worker k to processor k during run (previous affinity restored after batch)
+		static bool affinity;
+		// inner loops as subtasks (false: serial inside task)
+		static bool subtaskEnable;
+		// wall time of batches
+		static double wallTime;
+		// worker index of calling thread (-1: not a pool worker)
+		static PAIS_THREAD_LOCAL int workerIdx;
+
+		// pop own newest task or steal oldest task of other worker
+		static bool getTask(const int w, Task &task);
+		// pop own newest task if it belongs to batch of pending counter
+		static bool getBatchTask(const int w, volatile long *pending, Task &task);
+		static void pushTask(const int w, const Task &task);
+		static void execute(const int w, const Task &task);
+
+	public:
+		// set worker number (0: processor number), affinity and subtask mode (statistics are cleared)
+		static void setup(const int threadNum, const bool affinity, const bool subtaskEnable);
+		static int getThreadNumber() { return (int) workers.size(); }
+
+		// execute func(0..num-1) as tasks on pool workers and wait (inside a task: as subtasks)
+		static void run(const int num, TaskFunction func, void *obj);
+		// loop func(0..num-1) as subtasks of calling task (outside pool: OpenMP loop)
+		static void parallelFor(const int num, TaskFunction func, void *obj);
+		// calling thread is a pool worker
+		static bool isWorker() { return workerIdx >= 0; }
+
+		// per worker utilization statistics
+		static void clearStatistics();
+		static void printStatistics();
+	};
+};
+
+#endif
\ No newline at end of file
@@ -4,6 +4,15 @@
 
 #include <opencv2\opencv.hpp>
 
+// thread local storage (POD only)
+#ifndef PAIS_THREAD_LOCAL
+	#ifdef _MSC_VER
+		#define PAIS_THREAD_LOCAL __declspec(thread)
+	#else
+		#define PAIS_THREAD_LOCAL __thread
+	#endif
+#endif
+
 //#include "camera.h"
 
 //using namespace PAIS;
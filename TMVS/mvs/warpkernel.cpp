@@ -0,0 +1,323 @@
+#include "warpkernel.h"
+
+#ifdef PAIS_WARP_AVX2
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define PAIS_TARGET_AVX2
+	#else
+		#define PAIS_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+using namespace PAIS;
+
+const double WarpKernel::OVERFLOW_SAMPLE = -1.0;
+
+WarpKernel::WarpFunc  WarpKernel::warpFunc  = WarpKernel::selectKernel();
+WarpKernel::WarpFuncF WarpKernel::warpFuncF = WarpKernel::selectKernelF();
+
+/* kernel selection */
+
+bool WarpKernel::isAVX2Supported() {
+#if defined(PAIS_WARP_AVX2) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+
+	// OSXSAVE and AVX
+	__cpuid(info, 1);
+	if ( (info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 ) return false;
+
+	// OS saves XMM and YMM state
+	if ( (_xgetbv(0) & 0x6) != 0x6 ) return false;
+
+	// AVX2
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(PAIS_WARP_AVX2)
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+WarpKernel::WarpFunc WarpKernel::selectKernel() {
+#ifdef PAIS_WARP_AVX2
+	if ( isAVX2Supported() ) return warpAVX2;
+#endif
+	return warpScalar;
+}
+
+WarpKernel::WarpFuncF WarpKernel::selectKernelF() {
+#ifdef PAIS_WARP_AVX2
+	if ( isAVX2Supported() ) return warpAVX2;
+#endif
+	return warpScalar;
+}
+
+void WarpKernel::setScalarOnly(const bool scalarOnly) {
+	if (scalarOnly) {
+		warpFunc  = warpScalar;
+		warpFuncF = warpScalar;
+	} else {
+		warpFunc  = selectKernel();
+		warpFuncF = selectKernelF();
+	}
+}
+
+bool WarpKernel::isAVX2Enable() {
+	return warpFunc != (WarpFunc) warpScalar;
+}
+
+/* scalar kernel */
+
+// bilinear sample at homogeneous point (hx, hy, w) of target image
+template <typename T>
+static inline T sampleScalar(const Mat_<uchar> &img, const T hx, const T hy, const T w) {
+	// homography projection (with LOD transform)
+	const T r  = (T) 1 / w;
+	const T ix = hx * r;
+	const T iy = hy * r;
+
+	// skip overflow cases
+	if (ix < 2 || ix >= img.cols-3 || iy < 2 || iy >= img.rows-3 || w == 0) {
+		return (T) WarpKernel::OVERFLOW_SAMPLE;
+	}
+
+	// interpolation neighbor points
+	const int px0 = (int) ix;
+	const int py0 = (int) iy;
+	const int px1 = px0 + 1;
+	const int py1 = py0 + 1;
+
+	const uchar *row0 = img.data + py0*img.step;
+	const uchar *row1 = row0 + img.step;
+
+	return (T) row0[px0]*(px1-ix)*(py1-iy) +
+	       (T) row0[px1]*(ix-px0)*(py1-iy) +
+	       (T) row1[px0]*(px1-ix)*(iy-py0) +
+	       (T) row1[px1]*(ix-px0)*(iy-py0);
+}
+
+// warp pixels x0+k0 ~ x0+n-1 of scanline y (homogeneous point stepped by first column of H,
+// re-evaluated every 8 pixels to bound accumulated rounding, the AVX2 kernels re-evaluate it per loop too)
+template <typename T>
+static inline void warpRowScalar(const T *H, const Mat_<uchar> &img, const T x0, const T y, const int k0, const int n, T *out) {
+	const T hy0 = H[1] * y + H[2];
+	const T hy1 = H[4] * y + H[5];
+	const T hy2 = H[7] * y + H[8];
+	T x, hx, hy, w;
+	for (int k = k0; k < n; ++k) {
+		if ( ((k-k0) & 7) == 0 ) {
+			x  = x0 + k;
+			hx = H[0] * x + hy0;
+			hy = H[3] * x + hy1;
+			w  = H[6] * x + hy2;
+		}
+		out[k] = sampleScalar(img, hx, hy, w);
+		hx += H[0];
+		hy += H[3];
+		w  += H[6];
+	}
+}
+
+void WarpKernel::warpScalar(const double *H, const Mat_<uchar> &img, const double x0, const double y, const int n, double *out) {
+	warpRowScalar(H, img, x0, y, 0, n, out);
+}
+
+void WarpKernel::warpScalar(const float *H, const Mat_<uchar> &img, const float x0, const float y, const int n, float *out) {
+	warpRowScalar(H, img, x0, y, 0, n, out);
+}
+
+/* AVX2 kernel */
+
+#ifdef PAIS_WARP_AVX2
+
+// sample 4 pixels at homogeneous points (hx, hy, w)
+PAIS_TARGET_AVX2
+static inline void sampleQuadAVX2(const __m256d &hx, const __m256d &hy, const __m256d &w,
+                                  const __m256d &minP, const __m256d &maxX, const __m256d &maxY,
+                                  const uchar *data, const int step, double *out) {
+	// homography projection (one reciprocal per pixel)
+	const __m256d r  = _mm256_div_pd(_mm256_set1_pd(1.0), w);
+	const __m256d ix = _mm256_mul_pd(hx, r);
+	const __m256d iy = _mm256_mul_pd(hy, r);
+
+	// in bound mask (ordered compare, NaN is overflow)
+	__m256d valid = _mm256_and_pd(_mm256_cmp_pd(ix, minP, _CMP_GE_OQ), _mm256_cmp_pd(ix, maxX, _CMP_LT_OQ));
+	valid = _mm256_and_pd(valid, _mm256_cmp_pd(iy, minP, _CMP_GE_OQ));
+	valid = _mm256_and_pd(valid, _mm256_cmp_pd(iy, maxY, _CMP_LT_OQ));
+	valid = _mm256_and_pd(valid, _mm256_cmp_pd(w, _mm256_setzero_pd(), _CMP_NEQ_OQ));
+
+	const int validBits = _mm256_movemask_pd(valid);
+	if (validBits == 0) {
+		_mm256_storeu_pd(out, _mm256_set1_pd(WarpKernel::OVERFLOW_SAMPLE));
+		return;
+	}
+
+	// interpolation neighbor points (overflow lanes fetch pixel (0, 0))
+	const __m128i one  = _mm_set1_epi32(1);
+	const __m128i px0  = _mm256_cvttpd_epi32(ix);
+	const __m128i py0  = _mm256_cvttpd_epi32(iy);
+	const __m128i lane = _mm_sub_epi32(_mm_setzero_si128(), _mm256_cvtpd_epi32(_mm256_and_pd(valid, _mm256_set1_pd(1.0))));
+	const __m128i idx  = _mm_and_si128(_mm_add_epi32(_mm_mullo_epi32(py0, _mm_set1_epi32(step)), px0), lane);
+
+	// one 32-bit gather fetches (px0, py) and (px1, py)
+	const __m128i byteMask = _mm_set1_epi32(0xFF);
+	const __m128i row0 = _mm_i32gather_epi32((const int*) data, idx, 1);
+	const __m128i row1 = _mm_i32gather_epi32((const int*) (data + step), idx, 1);
+	const __m256d c00 = _mm256_cvtepi32_pd(_mm_and_si128(row0, byteMask));
+	const __m256d c10 = _mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(row0, 8), byteMask));
+	const __m256d c01 = _mm256_cvtepi32_pd(_mm_and_si128(row1, byteMask));
+	const __m256d c11 = _mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(row1, 8), byteMask));
+
+	// bilinear weighting
+	const __m256d fx1 = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_add_epi32(px0, one)), ix);
+	const __m256d fy1 = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_add_epi32(py0, one)), iy);
+	const __m256d fx0 = _mm256_sub_pd(ix, _mm256_cvtepi32_pd(px0));
+	const __m256d fy0 = _mm256_sub_pd(iy, _mm256_cvtepi32_pd(py0));
+
+	__m256d c = _mm256_mul_pd(_mm256_mul_pd(c00, fx1), fy1);
+	c = _mm256_add_pd(c, _mm256_mul_pd(_mm256_mul_pd(c10, fx0), fy1));
+	c = _mm256_add_pd(c, _mm256_mul_pd(_mm256_mul_pd(c01, fx1), fy0));
+	c = _mm256_add_pd(c, _mm256_mul_pd(_mm256_mul_pd(c11, fx0), fy0));
+
+	_mm256_storeu_pd(out, _mm256_blendv_pd(_mm256_set1_pd(WarpKernel::OVERFLOW_SAMPLE), c, valid));
+}
+
+PAIS_TARGET_AVX2
+void WarpKernel::warpAVX2(const double *H, const Mat_<uchar> &img, const double x0, const double y, const int n, double *out) {
+	// image bound [2, cols-3) x [2, rows-3)
+	const __m256d minP = _mm256_set1_pd(2.0);
+	const __m256d maxX = _mm256_set1_pd(img.cols-3);
+	const __m256d maxY = _mm256_set1_pd(img.rows-3);
+	const int step     = (int) img.step;
+
+	// homogeneous point of scanline y (affine in x)
+	const __m256d h0  = _mm256_set1_pd(H[0]);
+	const __m256d h3  = _mm256_set1_pd(H[3]);
+	const __m256d h6  = _mm256_set1_pd(H[6]);
+	const __m256d hy0 = _mm256_set1_pd(H[1] * y + H[2]);
+	const __m256d hy1 = _mm256_set1_pd(H[4] * y + H[5]);
+	const __m256d hy2 = _mm256_set1_pd(H[7] * y + H[8]);
+
+	// scanline steps of 4 pixels
+	const __m256d dhx = _mm256_set1_pd(H[0]*4.0);
+	const __m256d dhy = _mm256_set1_pd(H[3]*4.0);
+	const __m256d dw  = _mm256_set1_pd(H[6]*4.0);
+
+	// pixels x0+k+0 ~ x0+k+3 (a) and x0+k+4 ~ x0+k+7 (b)
+	const __m256d offset = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+	__m256d x, hxa, hya, wa, hxb, hyb, wb;
+
+	int k = 0;
+	// 8 pixels per loop, homogeneous point re-evaluated every 8 pixels as the scalar kernel
+	for (; k+8 <= n; k += 8) {
+		x   = _mm256_add_pd(_mm256_set1_pd(x0 + k), offset);
+		hxa = _mm256_add_pd(_mm256_mul_pd(h0, x), hy0);
+		hya = _mm256_add_pd(_mm256_mul_pd(h3, x), hy1);
+		wa  = _mm256_add_pd(_mm256_mul_pd(h6, x), hy2);
+		hxb = _mm256_add_pd(hxa, dhx);
+		hyb = _mm256_add_pd(hya, dhy);
+		wb  = _mm256_add_pd(wa, dw);
+		sampleQuadAVX2(hxa, hya, wa, minP, maxX, maxY, img.data, step, out+k);
+		sampleQuadAVX2(hxb, hyb, wb, minP, maxX, maxY, img.data, step, out+k+4);
+	}
+	// 4 pixels
+	if (k+4 <= n) {
+		x   = _mm256_add_pd(_mm256_set1_pd(x0 + k), offset);
+		hxa = _mm256_add_pd(_mm256_mul_pd(h0, x), hy0);
+		hya = _mm256_add_pd(_mm256_mul_pd(h3, x), hy1);
+		wa  = _mm256_add_pd(_mm256_mul_pd(h6, x), hy2);
+		sampleQuadAVX2(hxa, hya, wa, minP, maxX, maxY, img.data, step, out+k);
+		k += 4;
+	}
+	// remainder
+	warpRowScalar(H, img, x0, y, k, n, out);
+}
+
+// sample 8 pixels at homogeneous points (hx, hy, w) in single precision
+PAIS_TARGET_AVX2
+static inline void sampleOctAVX2(const __m256 &hx, const __m256 &hy, const __m256 &w,
+                                 const __m256 &minP, const __m256 &maxX, const __m256 &maxY,
+                                 const uchar *data, const int step, float *out) {
+	// homography projection (one reciprocal per pixel)
+	const __m256 r  = _mm256_div_ps(_mm256_set1_ps(1.0f), w);
+	const __m256 ix = _mm256_mul_ps(hx, r);
+	const __m256 iy = _mm256_mul_ps(hy, r);
+
+	// in bound mask (ordered compare, NaN is overflow)
+	__m256 valid = _mm256_and_ps(_mm256_cmp_ps(ix, minP, _CMP_GE_OQ), _mm256_cmp_ps(ix, maxX, _CMP_LT_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(iy, minP, _CMP_GE_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(iy, maxY, _CMP_LT_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+
+	if (_mm256_movemask_ps(valid) == 0) {
+		_mm256_storeu_ps(out, _mm256_set1_ps((float) WarpKernel::OVERFLOW_SAMPLE));
+		return;
+	}
+
+	// interpolation neighbor points (overflow lanes fetch pixel (0, 0))
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i px0 = _mm256_cvttps_epi32(ix);
+	const __m256i py0 = _mm256_cvttps_epi32(iy);
+	const __m256i idx = _mm256_and_si256(_mm256_add_epi32(_mm256_mullo_epi32(py0, _mm256_set1_epi32(step)), px0), _mm256_castps_si256(valid));
+
+	// one 32-bit gather fetches (px0, py) and (px1, py)
+	const __m256i byteMask = _mm256_set1_epi32(0xFF);
+	const __m256i row0 = _mm256_i32gather_epi32((const int*) data, idx, 1);
+	const __m256i row1 = _mm256_i32gather_epi32((const int*) (data + step), idx, 1);
+	const __m256 c00 = _mm256_cvtepi32_ps(_mm256_and_si256(row0, byteMask));
+	const __m256 c10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(row0, 8), byteMask));
+	const __m256 c01 = _mm256_cvtepi32_ps(_mm256_and_si256(row1, byteMask));
+	const __m256 c11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(row1, 8), byteMask));
+
+	// bilinear weighting
+	const __m256 fx1 = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(px0, one)), ix);
+	const __m256 fy1 = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(py0, one)), iy);
+	const __m256 fx0 = _mm256_sub_ps(ix, _mm256_cvtepi32_ps(px0));
+	const __m256 fy0 = _mm256_sub_ps(iy, _mm256_cvtepi32_ps(py0));
+
+	__m256 c = _mm256_mul_ps(_mm256_mul_ps(c00, fx1), fy1);
+	c = _mm256_add_ps(c, _mm256_mul_ps(_mm256_mul_ps(c10, fx0), fy1));
+	c = _mm256_add_ps(c, _mm256_mul_ps(_mm256_mul_ps(c01, fx1), fy0));
+	c = _mm256_add_ps(c, _mm256_mul_ps(_mm256_mul_ps(c11, fx0), fy0));
+
+	_mm256_storeu_ps(out, _mm256_blendv_ps(_mm256_set1_ps((float) WarpKernel::OVERFLOW_SAMPLE), c, valid));
+}
+
+PAIS_TARGET_AVX2
+void WarpKernel::warpAVX2(const float *H, const Mat_<uchar> &img, const float x0, const float y, const int n, float *out) {
+	// image bound [2, cols-3) x [2, rows-3)
+	const __m256 minP = _mm256_set1_ps(2.0f);
+	const __m256 maxX = _mm256_set1_ps((float) (img.cols-3));
+	const __m256 maxY = _mm256_set1_ps((float) (img.rows-3));
+	const int step    = (int) img.step;
+
+	// homogeneous point of scanline y (affine in x)
+	const __m256 h0  = _mm256_set1_ps(H[0]);
+	const __m256 h3  = _mm256_set1_ps(H[3]);
+	const __m256 h6  = _mm256_set1_ps(H[6]);
+	const __m256 hy0 = _mm256_set1_ps(H[1] * y + H[2]);
+	const __m256 hy1 = _mm256_set1_ps(H[4] * y + H[5]);
+	const __m256 hy2 = _mm256_set1_ps(H[7] * y + H[8]);
+
+	// pixels x0+k+0 ~ x0+k+7
+	const __m256 offset = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+	__m256 x, hx, hy, w;
+
+	int k = 0;
+	// 8 pixels per loop, homogeneous point re-evaluated every 8 pixels as the scalar kernel
+	for (; k+8 <= n; k += 8) {
+		x  = _mm256_add_ps(_mm256_set1_ps(x0 + k), offset);
+		hx = _mm256_add_ps(_mm256_mul_ps(h0, x), hy0);
+		hy = _mm256_add_ps(_mm256_mul_ps(h3, x), hy1);
+		w  = _mm256_add_ps(_mm256_mul_ps(h6, x), hy2);
+		sampleOctAVX2(hx, hy, w, minP, maxX, maxY, img.data, step, out+k);
+	}
+	// remainder
+	warpRowScalar(H, img, x0, y, k, n, out);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef __PAIS_WARP_KERNEL_H__
+#define __PAIS_WARP_KERNEL_H__
+
+#include <opencv2\opencv.hpp>
+
+// AVX2 intrinsics are available since VS2012 (not in VS2010) and in GCC/Clang
+#if (defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__GNUC__)
+	#define PAIS_WARP_AVX2
+#endif
+
+using namespace cv;
+
+namespace PAIS {
+	/*
+		homography warp and bilinear sampling kernel of patch fitness
+
+		warp a scanline of n pixels (x0, y), (x0+1, y), ..., (x0+n-1, y) on
+		reference image into target image by 3x3 row-major homography H, and
+		bilinear sample the target image. Sample out of [2, cols-3) x [2, rows-3)
+		is marked as WarpKernel::OVERFLOW_SAMPLE. AVX2 kernel is selected at
+		runtime, otherwise fall back to the scalar kernel.
+
+		along a scanline the homogeneous point (hx, hy, w) is affine in x, it is
+		stepped by the first column of H and divided by one reciprocal per pixel.
+		Scanlines walk the target image rows, so bilinear fetches are contiguous.
+
+		AVX2 kernel warps 8 pixels per loop (double: two 4-lane vectors, float:
+		one 8-lane vector), samples are identical to the scalar kernel up to
+		floating point rounding (tolerance 1e-9 on patch fitness).
+	*/
+	class WarpKernel {
+	private:
+		WarpKernel(void);
+		~WarpKernel(void);
+
+		typedef void (*WarpFunc)(const double *H, const Mat_<uchar> &img, const double x0, const double y, const int n, double *out);
+		typedef void (*WarpFuncF)(const float *H, const Mat_<uchar> &img, const float x0, const float y, const int n, float *out);
+
+		// selected kernel (double, float)
+		static WarpFunc  warpFunc;
+		static WarpFuncF warpFuncF;
+
+		// select kernel from cpu feature
+		static WarpFunc  selectKernel();
+		static WarpFuncF selectKernelF();
+
+		static void warpScalar(const double *H, const Mat_<uchar> &img, const double x0, const double y, const int n, double *out);
+		static void warpScalar(const float *H, const Mat_<uchar> &img, const float x0, const float y, const int n, float *out);
+	#ifdef PAIS_WARP_AVX2
+		static void warpAVX2(const double *H, const Mat_<uchar> &img, const double x0, const double y, const int n, double *out);
+		static void warpAVX2(const float *H, const Mat_<uchar> &img, const float x0, const float y, const int n, float *out);
+	#endif
+
+	public:
+		// marker of out of image bound sample
+		static const double OVERFLOW_SAMPLE;
+
+		// check cpu and os support AVX2
+		static bool isAVX2Supported();
+		// force scalar kernel (for verification)
+		static void setScalarOnly(const bool scalarOnly);
+		// is AVX2 kernel in use
+		static bool isAVX2Enable();
+
+		// warp a scanline of n pixels into target image
+		static void warp(const double *H, const Mat_<uchar> &img, const double x0, const double y, const int n, double *out) {
+			warpFunc(H, img, x0, y, n, out);
+		}
+		static void warp(const float *H, const Mat_<uchar> &img, const float x0, const float y, const int n, float *out) {
+			warpFuncF(H, img, x0, y, n, out);
+		}
+	};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <math.h>
+
+#include "fitnesscache.h"
+
+using namespace PAIS;
+
+long long FitnessCache::totalQueries = 0;
+long long FitnessCache::totalHits    = 0;
+
+FitnessCache::FitnessCache(void) {
+	dim      = 0;
+	capacity = 0;
+	size     = 0;
+	queries  = 0;
+	hits     = 0;
+}
+
+FitnessCache::~FitnessCache(void) {
+
+}
+
+void FitnessCache::setup(const int dim, const double *quantum, const int capacity) {
+	this->dim = dim;
+	this->quantum.assign(quantum, quantum + dim);
+
+	// load factor under 1/2
+	this->capacity = 16;
+	while (this->capacity < capacity*2) {
+		this->capacity <<= 1;
+	}
+
+	keyBuffer.resize(dim);
+	keys.resize(this->capacity * dim);
+	values.resize(this->capacity);
+	exact.resize(this->capacity);
+	used.resize(this->capacity);
+	clear();
+}
+
+void FitnessCache::clear() {
+	used.assign(used.size(), 0);
+	size    = 0;
+	queries = 0;
+	hits    = 0;
+}
+
+void FitnessCache::addTotal() const {
+	#pragma omp atomic
+	totalQueries += queries;
+	#pragma omp atomic
+	totalHits += hits;
+}
+
+void FitnessCache::clearTotal() {
+	totalQueries = 0;
+	totalHits    = 0;
+}
+
+void FitnessCache::quantize(const double *pos, long long *key) const {
+	for (int d = 0; d < dim; ++d) {
+		key[d] = (long long) floor(pos[d] / quantum[d] + 0.5);
+	}
+}
+
+int FitnessCache::find(const long long *key) const {
+	// FNV-1a of quantized position
+	unsigned long long h = 14695981039346656037ULL;
+	for (int d = 0; d < dim; ++d) {
+		h = (h ^ (unsigned long long) key[d]) * 1099511628211ULL;
+	}
+
+	// linear probing
+	const int mask = capacity - 1;
+	int slot = (int) (h & mask);
+	for (int n = 0; n < capacity; ++n, slot = (slot+1) & mask) {
+		if ( !used[slot] ) return slot;
+
+		const long long *k = &keys[slot*dim];
+		bool match = true;
+		for (int d = 0; d < dim && match; ++d) {
+			match = (k[d] == key[d]);
+		}
+		if (match) return slot;
+	}
+	return -1;
+}
+
+bool FitnessCache::lookup(const double *pos, const double bound, double &fitness) {
+	if (dim == 0) return false;
+	++queries;
+
+	long long *k = &keyBuffer[0];
+	quantize(pos, k);
+
+	const int slot = find(k);
+	if (slot < 0 || !used[slot]) return false;
+
+	// lower bound is valid only above given bound
+	if ( !exact[slot] && !(values[slot] > bound) ) return false;
+
+	fitness = values[slot];
+	++hits;
+	return true;
+}
+
+void FitnessCache::insert(const double *pos, const double bound, const double fitness) {
+	if (dim == 0) return;
+
+	long long *k = &keyBuffer[0];
+	quantize(pos, k);
+
+	const int slot = find(k);
+	if (slot < 0) return;
+
+	// keep table under load factor 1/2
+	if ( !used[slot] ) {
+		if ((size+1)*2 > capacity) return;
+		used[slot] = 1;
+		++size;
+		for (int d = 0; d < dim; ++d) {
+			keys[slot*dim+d] = k[d];
+		}
+	}
+	values[slot] = fitness;
+	exact[slot]  = (fitness <= bound);
+}
\ No newline at end of file
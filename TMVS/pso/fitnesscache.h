@@ -0,0 +1,76 @@
+#ifndef __PAIS_FITNESS_CACHE_H__
+#define __PAIS_FITNESS_CACHE_H__
+
+#include <vector>
+
+using namespace std;
+
+namespace PAIS {
+	/*
+		fitness memoization of quantized particle positions in a solve
+
+		positions are quantized by a quantum per dimension, an open addressing
+		table maps quantized position to fitness. Fitness evaluated under a
+		bound is exact only when not above the bound, otherwise it's a lower
+		bound and is reused only for a query whose bound it still exceeds.
+	*/
+	class FitnessCache {
+	private:
+		// dimension (0: disable)
+		int dim;
+		// quantum of each dimension
+		vector<double> quantum;
+
+		// open addressing table (power of 2 capacity)
+		int capacity;
+		int size;
+		vector<long long> keys;   // capacity * dim
+		vector<double>    values;
+		vector<char>      exact;
+		vector<char>      used;
+		// quantized position of query
+		vector<long long> keyBuffer;
+
+		// statistics
+		long long queries;
+		long long hits;
+		// statistics of all solves since last clearTotal
+		static long long totalQueries;
+		static long long totalHits;
+
+		// quantized position
+		void quantize(const double *pos, long long *key) const;
+		// slot of key (matched or empty, -1 if table is full)
+		int find(const long long *key) const;
+
+	public:
+		FitnessCache(void);
+		~FitnessCache(void);
+
+		// enable cache of dimension and quantum (capacity: expected evaluation number)
+		void setup(const int dim, const double *quantum, const int capacity);
+		// clear entries and statistics
+		void clear();
+		// disable cache (table kept for next setup)
+		void disable() { dim = 0; }
+
+		bool isEnable() const { return dim > 0; }
+
+		// cached fitness of position valid under bound
+		bool lookup(const double *pos, const double bound, double &fitness);
+		// cache fitness of position evaluated under bound
+		void insert(const double *pos, const double bound, const double fitness);
+
+		long long getQueries() const { return queries; }
+		long long getHits()    const { return hits;    }
+		double    getHitRate() const { return (queries > 0) ? (double) hits / queries : 0.0; }
+
+		// add statistics of a finished solve to totals (thread safe)
+		void addTotal() const;
+		static void clearTotal();
+		static long long getTotalQueries() { return totalQueries; }
+		static double    getTotalHitRate() { return (totalQueries > 0) ? (double) totalHits / totalQueries : 0.0; }
+	};
+};
+
+#endif
\ No newline at end of file
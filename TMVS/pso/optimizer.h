@@ -0,0 +1,35 @@
+#ifndef __PAIS_OPTIMIZER_H__
+#define __PAIS_OPTIMIZER_H__
+
+namespace PAIS {
+	/*
+		minimizer of fitness function over a Dim dimensional box
+
+		common interface of optimization backends (PSO, simplex), a backend
+		is re-armed by its own reset() and then driven through this interface.
+	*/
+	template <int Dim>
+	class Optimizer {
+	public:
+		virtual ~Optimizer(void) {}
+
+		// set batch fitness function (bounds: fitness above bound may stop evaluation)
+		virtual void setFitnessBatch(void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj)) = 0;
+		// set initial guess of solution
+		virtual bool setInitialGuess(const double *pos) = 0;
+		// set fitness evaluation budget of optimization (0: unlimited, reset by backend reset)
+		virtual void setMaxEvaluations(const int maxEvaluations) = 0;
+		// minimize fitness
+		virtual void optimize() = 0;
+
+		// best solution and fitness
+		virtual const double* getGbest()        const = 0;
+		virtual double        getGbestFitness() const = 0;
+		// number of iteration in last optimization
+		virtual int           getIteration()    const = 0;
+		// number of fitness evaluation in last optimization
+		virtual int           getEvaluations()  const = 0;
+	};
+};
+
+#endif
\ No newline at end of file
@@ -1,20 +1,88 @@
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <emmintrin.h>
+
 #include "psosolver.h"
 
-bool PsoSolver::sortLocalParticle (const LocalParticle &i, const LocalParticle &j) {
-    return (i.dist < j.dist); 
+// SIMD width (doubles) of particle state rows
+#define PSO_SIMD_WIDTH 4
+
+// prime bases of Halton sequence (one per dimension)
+static const int HALTON_BASE[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29};
+
+// radical inverse of index in base (van der Corput sequence)
+static double radicalInverse(int index, const int base) {
+	const double inv = 1.0 / base;
+	double f = inv;
+	double r = 0;
+	while (index > 0) {
+		r += f * (index % base);
+		index /= base;
+		f *= inv;
+	}
+	return r;
+}
+
+// nearer pBest first
+static bool compareLocalParticle(const LocalParticle &i, const LocalParticle &j) {
+	return (i.dist < j.dist);
+}
+
+template <int Dim>
+long long PsoSolver<Dim>::stopCount[PsoSolver<Dim>::STOP_REASON_NUM] = {0};
+
+template <int Dim>
+bool PsoSolver<Dim>::scalarOnly = false;
+
+template <int Dim>
+PsoSolver<Dim>::PsoSolver(void) {
+	this->block    = NULL;
+	this->capacity = 0;
+	this->seed     = 0;
+	this->initMode = INIT_RANDOM;
+	this->particleNum = 0;
+	this->stride      = 0;
+	this->iteration   = 0;
+	this->evaluations = 0;
+	this->gBestFitness   = DBL_MAX;
+	this->gBestIteration = -1;
+	this->bounded     = false;
+	this->initialized = false;
+	this->relativeThreshold   = 0;
+	this->stagnationIteration = 0;
+	this->maxEvaluations      = 0;
+	this->stagnation          = 0;
+	this->stopReason          = STOP_NONE;
+}
+
+template <int Dim>
+PsoSolver<Dim>::PsoSolver(const double *rangeL, const double *rangeU,
+				  double (*getFitness)(const double *pos, void *obj),
+				  void *obj,
+				  int maxIteration, int particleNum,
+				  double convergenceThreshold,
+				  double iw, double pw, double gw, double lw, double nw,
+				  int localK) {
+	this->block    = NULL;
+	this->capacity = 0;
+	this->seed     = 0;
+	this->initMode = INIT_RANDOM;
+
+	reset(rangeL, rangeU, getFitness, obj, maxIteration, particleNum, convergenceThreshold, iw, pw, gw, lw, nw, localK);
 }
 
-PsoSolver::PsoSolver(const int dim, 
-			      const double *rangeL, const double *rangeU, 
-				  double (*getFitness)(const Particle &p, void *obj), 
+template <int Dim>
+void PsoSolver<Dim>::reset(const double *rangeL, const double *rangeU,
+				  double (*getFitness)(const double *pos, void *obj),
 				  void *obj,
 				  int maxIteration, int particleNum,
-				  double convergenceThreshold, 
+				  double convergenceThreshold,
 				  double iw, double pw, double gw, double lw, double nw,
 				  int localK) {
-	this->dim            = dim;
 	this->maxIteration   = maxIteration;
 	this->getFitness     = getFitness;
+	this->getFitnessBatch = NULL;
 	this->obj            = obj;
 	this->particleNum    = particleNum;
 	this->convergenceThreshold = convergenceThreshold;
@@ -25,282 +93,735 @@ PsoSolver::PsoSolver(const int dim,
 	this->nw = nw;
 	this->localK = min(particleNum, localK);
 
-	this->rangeL         = new double[dim];
-	this->rangeU         = new double[dim];
-	this->rangeInter     = new double[dim];
-	this->gBest          = NULL;
+	this->iteration      = 0;
+	this->evaluations    = 0;
 	this->gBestFitness   = DBL_MAX;
 	this->gBestIteration = -1;
+	this->stagnation     = 0;
+	this->stopReason     = STOP_NONE;
+
+	// adaptive stopping is set per problem
+	this->relativeThreshold   = 0;
+	this->stagnationIteration = 0;
+	this->maxEvaluations      = 0;
 
-	for (int i = 0; i < dim; i++) {
+	for (int i = 0; i < Dim; i++) {
 		this->rangeL[i]     = rangeL[i];
 		this->rangeU[i]     = rangeU[i];
 		this->rangeInter[i] = rangeU[i] - rangeL[i];
+		this->gBest[i]      = rangeL[i];
 	}
 
-	setRandomSeed();
-	initParticles();
+	// particle state block: 5 states of Dim rows and 4 weighting rows, zeroed with padding lanes
+	const int rowNum = 5*Dim + 4;
+	this->stride = (particleNum + PSO_SIMD_WIDTH - 1) / PSO_SIMD_WIDTH * PSO_SIMD_WIDTH;
+	if (stride > capacity) {
+		if (block) _mm_free(block);
+		capacity = stride;
+		block    = (double *) _mm_malloc(sizeof(double) * rowNum * capacity, 32);
+	}
+	for (int i = 0; i < rowNum * stride; i++) {
+		block[i] = 0;
+	}
+	this->pos   = block;
+	this->vec   = pos   + Dim*stride;
+	this->pBest = vec   + Dim*stride;
+	this->nBest = pBest + Dim*stride;
+	this->lBest = nBest + Dim*stride;
+	this->pVecW = lBest + Dim*stride;
+	this->gVecW = pVecW + stride;
+	this->lVecW = gVecW + stride;
+	this->nVecW = lVecW + stride;
+
+	cache.disable();
+
+	placedPos.resize(particleNum*Dim);
+	placedVec.resize(particleNum*Dim);
+	placedState.assign(particleNum, 0);
 }
 
-PsoSolver::~PsoSolver() {
-	if (rangeL) {
-		delete [] rangeL;
-		rangeL = NULL;
-	}
-	if (rangeU) {
-		delete [] rangeU;
-		rangeU = NULL;
+template <int Dim>
+PsoSolver<Dim>::~PsoSolver() {
+	if (block) {
+		_mm_free(block);
+		block = NULL;
 	}
-	if (rangeInter) {
-		delete [] rangeInter;
-		rangeInter = NULL;
+}
+
+template <int Dim>
+void PsoSolver<Dim>::initRandomStreams() {
+	streams.resize(particleNum);
+	for (int i = 0; i < particleNum; i++) {
+		streams[i].setKey(seed, i);
 	}
 }
 
-void PsoSolver::setRandomSeed() const {
-	// set random seed
-	unsigned int seed = (unsigned int) time(NULL) + omp_get_thread_num();
-	srand(seed);
+template <int Dim>
+void PsoSolver<Dim>::setRandomSeed(const unsigned long long seed) {
+	this->seed = seed;
 }
 
-inline double PsoSolver::random() {
-	return ((double) rand()) / ((double) RAND_MAX);
+template <int Dim>
+void PsoSolver<Dim>::setInitMode(const int initMode) {
+	this->initMode = initMode;
 }
 
-double PsoSolver::getDispersionIDX() const {
+template <int Dim>
+double PsoSolver<Dim>::getDispersionIDX() const {
+	const __m128d signMask = _mm_set1_pd(-0.0);
+	__m128d sum = _mm_setzero_pd();
 	double index = 0;
-	for (int i = 0; i < particleNum; i++) {
-		const Particle &p = particles[i];
-		for (int j = 0; j < dim; j++) {
-			index += abs(p.pos[j] - gBest[j]);
+	for (int d = 0; d < Dim; d++) {
+		const double *x = pos + d*stride;
+		const __m128d g = _mm_set1_pd(gBest[d]);
+		int i = 0;
+		for (; i+1 < particleNum; i += 2) {
+			sum = _mm_add_pd(sum, _mm_andnot_pd(signMask, _mm_sub_pd(_mm_load_pd(x+i), g)));
+		}
+		for (; i < particleNum; i++) {
+			index += abs(x[i] - gBest[d]);
 		}
 	}
-	index /= (dim*particleNum);
+	double lane[2];
+	_mm_storeu_pd(lane, sum);
+	index += lane[0] + lane[1];
+	index /= (Dim*particleNum);
 	return index;
 }
 
-double PsoSolver::getVelocityIDX()   const {
+template <int Dim>
+double PsoSolver<Dim>::getVelocityIDX()   const {
+	const __m128d signMask = _mm_set1_pd(-0.0);
+	__m128d sum = _mm_setzero_pd();
 	double index = 0;
-	for (int i = 0; i < particleNum; i++) {
-		const Particle &p = particles[i];
-		for (int j = 0; j < dim; j++) {
-			index += abs(p.vec[j]);
+	for (int d = 0; d < Dim; d++) {
+		const double *v = vec + d*stride;
+		int i = 0;
+		for (; i+1 < particleNum; i += 2) {
+			sum = _mm_add_pd(sum, _mm_andnot_pd(signMask, _mm_load_pd(v+i)));
+		}
+		for (; i < particleNum; i++) {
+			index += abs(v[i]);
 		}
 	}
-	index /= (dim*particleNum);
+	double lane[2];
+	_mm_storeu_pd(lane, sum);
+	index += lane[0] + lane[1];
+	index /= (Dim*particleNum);
 	return index;
 }
 
-void PsoSolver::initParticles() {
-	// allocate particle container
-	particles.clear();
-	particles.resize(particleNum, Particle(dim));
+template <int Dim>
+bool PsoSolver<Dim>::isRelativeConverged() const {
+	const __m128d signMask = _mm_set1_pd(-0.0);
+	for (int d = 0; d < Dim; d++) {
+		const double *x = pos + d*stride;
+		const double *v = vec + d*stride;
+		const __m128d g = _mm_set1_pd(gBest[d]);
+		__m128d xSum = _mm_setzero_pd();
+		__m128d vSum = _mm_setzero_pd();
+		double dispersion = 0;
+		double velocity   = 0;
+		int i = 0;
+		for (; i+1 < particleNum; i += 2) {
+			xSum = _mm_add_pd(xSum, _mm_andnot_pd(signMask, _mm_sub_pd(_mm_load_pd(x+i), g)));
+			vSum = _mm_add_pd(vSum, _mm_andnot_pd(signMask, _mm_load_pd(v+i)));
+		}
+		for (; i < particleNum; i++) {
+			dispersion += abs(x[i] - gBest[d]);
+			velocity   += abs(v[i]);
+		}
+		double lane[2];
+		_mm_storeu_pd(lane, xSum);
+		dispersion += lane[0] + lane[1];
+		_mm_storeu_pd(lane, vSum);
+		velocity   += lane[0] + lane[1];
+
+		// mean distance to gBest and mean speed in ratio of dimension range
+		const double limit = relativeThreshold * rangeInter[d] * particleNum;
+		if ( !(dispersion < limit && velocity < limit) ) return false;
+	}
+	return true;
+}
+
+template <int Dim>
+int PsoSolver<Dim>::checkStop() const {
+	if (iteration >= maxIteration) return STOP_MAX_ITERATION;
+	if (maxEvaluations > 0 && evaluations >= maxEvaluations) return STOP_BUDGET;
+	if (getDispersionIDX() < convergenceThreshold && getVelocityIDX() < convergenceThreshold) {
+		return STOP_CONVERGENCE;
+	}
+	if (relativeThreshold > 0 && isRelativeConverged()) return STOP_RELATIVE;
+	if (stagnationIteration > 0 && stagnation >= stagnationIteration) return STOP_STAGNATION;
+	return STOP_NONE;
+}
+
+template <int Dim>
+void PsoSolver<Dim>::initParticles() {
+	// reset particle fitness
+	fitness.assign(particleNum, DBL_MAX);
+	pBestFitness.assign(particleNum, DBL_MAX);
+	exactFitness.assign(particleNum, 1);
+
+	// random shift of Halton points per solve (Cranley-Patterson rotation, stream after particles)
+	double shift[Dim];
+	if (initMode == INIT_HALTON) {
+		RandomStream shiftStream(seed, particleNum);
+		shiftStream.uniform(shift, Dim);
+	}
 
 	// uniform random parameter between range
-	for (int d = 0; d < dim; d++) {
+	for (int d = 0; d < Dim; d++) {
 		for (int i = 0; i < particleNum; i++) {
-			// random position parameter (L~U)
-            particles[i].pos[d] = (rangeInter[d] * random()) + rangeL[d];
+			const int idx = d*stride + i;
+			// random position parameter (L~U), drawn in all modes to keep velocity draws
+			double u = streams[i].uniform();
+			if (initMode == INIT_HALTON) {
+				// evenly covered position parameter (L~U), index 0 of sequence is skipped
+				u = radicalInverse(i+1, HALTON_BASE[d]) + shift[d];
+				if (u >= 1.0) u -= 1.0;
+			}
+            pos[idx] = (rangeInter[d] * u) + rangeL[d];
             // random velocity parameter (-|U-L| ~ |U-L|), known as velocity inertia
-            particles[i].vec[d] = (2.0 * rangeInter[d] * random()) - rangeInter[d];
+            vec[idx] = (2.0 * rangeInter[d] * streams[i].uniform()) - rangeInter[d];
             // set pBest as initial position
-            particles[i].pBest[d] = particles[i].pos[d];
+            pBest[idx] = pos[idx];
+			nBest[idx] = 0;
+			lBest[idx] = pos[idx];
 		}
 	}
 }
 
-void PsoSolver::initFitness() {
-	#pragma omp parallel for
+template <int Dim>
+void PsoSolver<Dim>::prepareFitness(const bool bounded) {
+	this->bounded = bounded;
+	posBuffer.resize(particleNum*Dim);
+	fitnessBuffer.resize(particleNum);
+	boundBuffer.resize(particleNum);
+
+	// particle-major positions for fitness function
+	for (int d = 0; d < Dim; d++) {
+		const double *x = pos + d*stride;
+		for (int i = 0; i < particleNum; i++) {
+			posBuffer[i*Dim + d] = x[i];
+		}
+	}
+
+	// particle can't update pBest once fitness exceeds pBest fitness
 	for (int i = 0; i < particleNum; i++) {
-		Particle &p    = particles[i];
-		p.fitness      = getFitness(p, obj);
-		p.pBestFitness = p.fitness;
+		boundBuffer[i] = bounded ? pBestFitness[i] : DBL_MAX;
+	}
+
+	// skip particles in fitness cache
+	evalIdx.clear();
+	evalPos.clear();
+	evalBounds.clear();
+	for (int i = 0; i < particleNum; i++) {
+		const double *p = &posBuffer[i*Dim];
+		if ( cache.lookup(p, boundBuffer[i], fitnessBuffer[i]) ) continue;
+		evalIdx.push_back(i);
+		evalPos.push_back(p);
+		// single particle fitness is exact
+		evalBounds.push_back(getFitnessBatch != NULL ? boundBuffer[i] : DBL_MAX);
+	}
+
+	// last batch is cut to remaining budget, skipped particle keeps no fitness (stopped before evaluation)
+	if (maxEvaluations > 0) {
+		const int remain = max(maxEvaluations - evaluations, 0);
+		for (int n = remain; n < (int) evalIdx.size(); n++) {
+			fitnessBuffer[evalIdx[n]] = DBL_MAX;
+			boundBuffer[evalIdx[n]]   = -DBL_MAX;
+		}
+		if (remain < (int) evalIdx.size()) {
+			evalIdx.resize(remain);
+			evalPos.resize(remain);
+			evalBounds.resize(remain);
+		}
+	}
+	evalFitness.resize(evalIdx.size());
+}
+
+template <int Dim>
+void PsoSolver<Dim>::evaluate() {
+	const int num = (int) evalIdx.size();
+	if (num == 0) return;
+	evaluations += num;
+
+	if (getFitnessBatch != NULL) {
+		getFitnessBatch(&evalPos[0], num, bounded ? &evalBounds[0] : NULL, &evalFitness[0], obj);
+	} else {
+		// single particle fitness function adapter
+		#pragma omp parallel for
+		for (int n = 0; n < num; n++) {
+			evalFitness[n] = getFitness(evalPos[n], obj);
+		}
 	}
 }
 
-void PsoSolver::updateFitness() {
-	#pragma omp parallel for
+template <int Dim>
+void PsoSolver<Dim>::commitFitness() {
+	const int num = (int) evalIdx.size();
+	for (int n = 0; n < num; n++) {
+		fitnessBuffer[evalIdx[n]] = evalFitness[n];
+		cache.insert(evalPos[n], evalBounds[n], evalFitness[n]);
+	}
+}
+
+template <int Dim>
+void PsoSolver<Dim>::initFitness() {
+	for (int i = 0; i < particleNum; i++) {
+		fitness[i]      = fitnessBuffer[i];
+		pBestFitness[i] = fitness[i];
+		exactFitness[i] = (fitnessBuffer[i] <= boundBuffer[i]);
+	}
+}
+
+template <int Dim>
+void PsoSolver<Dim>::updateFitness() {
 	for (int i = 0; i < particleNum; i++) {
-		Particle &p    = particles[i];
-		p.fitness      = getFitness(p, obj);
-
-		// update pBest
-		if (p.fitness < p.pBestFitness) {
-			p.pBestFitness = p.fitness;
-			for (int d = 0; d < p.dim; d++) {
-				p.pBest[d] = p.pos[d];
+		fitness[i] = fitnessBuffer[i];
+		exactFitness[i] = (fitnessBuffer[i] <= boundBuffer[i]);
+
+		// update pBest (stopped evaluation is above pBest fitness)
+		if (fitness[i] < pBestFitness[i]) {
+			pBestFitness[i] = fitness[i];
+			for (int d = 0; d < Dim; d++) {
+				pBest[d*stride + i] = pos[d*stride + i];
 			}
 		}
 	} // end of update particles
 }
 
-void PsoSolver::updateGbest() {
+template <int Dim>
+void PsoSolver<Dim>::updateGbest() {
 	for (int j = 0; j < particleNum; j++) {
-        // current particle
-        const Particle &p = particles[j];
-
-		if (p.pBestFitness <= gBestFitness) {
-            gBestFitness   = p.pBestFitness;
-			gBest          = p.pBest;
+		if (pBestFitness[j] <= gBestFitness) {
+            gBestFitness   = pBestFitness[j];
+			for (int d = 0; d < Dim; d++) {
+				gBest[d] = pBest[d*stride + j];
+			}
 			gBestIteration = iteration;
 			// printf("update: %f\n", gBestFitness);
         }
     }
 }
 
-const double* PsoSolver::getLocalBest(const int idx) const {
-	// local particle container
-	vector<LocalParticle> container(particleNum);
-
-	// current pBest position
-	const double *pos = particles[idx].pBest;
+template <int Dim>
+void PsoSolver<Dim>::setDistance() {
+	distBuffer.resize(particleNum * stride);
 
-	// get Euclidean distence from pBest to current pBest position
+	// upper triangle along particles (2 particles per SIMD vector), mirrored to lower triangle
 	for (int i = 0; i < particleNum; i++) {
-		const Particle &p = particles[i];
-		LocalParticle &localP = container[i];
-		localP.dist = 0;
-		localP.p = &p;
-
-		if (i == idx) {
-			localP.dist = DBL_MAX;
-			continue;
+		double *row = &distBuffer[i*stride];
+		row[i] = 0;
+
+		int j = i+1;
+		for (; j+1 < particleNum; j += 2) {
+			__m128d sum = _mm_setzero_pd();
+			for (int d = 0; d < Dim; d++) {
+				const __m128d diff = _mm_sub_pd(_mm_set1_pd(pBest[d*stride + i]), _mm_loadu_pd(pBest + d*stride + j));
+				sum = _mm_add_pd(sum, _mm_mul_pd(diff, diff));
+			}
+			_mm_storeu_pd(row+j, sum);
+		}
+		for (; j < particleNum; j++) {
+			double sum = 0;
+			for (int d = 0; d < Dim; d++) {
+				const double diff = pBest[d*stride + i] - pBest[d*stride + j];
+				sum += diff*diff;
+			}
+			row[j] = sum;
 		}
 
-		for (int d = 0; d < dim; d++) {
-			localP.dist += (pos[d] - p.pBest[d])*(pos[d] - p.pBest[d]);
+		for (j = i+1; j < particleNum; j++) {
+			distBuffer[j*stride + i] = row[j];
 		}
 	}
+}
 
-	// sort by distance
-	sort(container.begin(), container.end(), sortLocalParticle);
+template <int Dim>
+int PsoSolver<Dim>::getLocalBest(const int idx) {
+	// distance row of current pBest
+	const double *row = &distBuffer[idx*stride];
+
+	// localK nearest neighbors sorted by distance (insertion into K slots)
+	LocalParticle *nearest = &localBuffer[idx*localK];
+	int num = 0;
+	for (int i = 0; i < particleNum; i++) {
+		if (i == idx) continue;
+		const double dist = row[i];
+		if (num == localK && dist >= nearest[num-1].dist) continue;
+
+		int k = (num < localK) ? num++ : num-1;
+		for (; k > 0 && nearest[k-1].dist > dist; k--) {
+			nearest[k] = nearest[k-1];
+		}
+		nearest[k].dist = dist;
+		nearest[k].idx  = i;
+	}
+	// current particle is the farthest neighbor when localK covers the swarm
+	if (num < localK) {
+		nearest[num].dist = DBL_MAX;
+		nearest[num].idx  = idx;
+		num++;
+	}
 
 	// find the minimum fitness pbest as lbest from localK nearest neighbors
 	double minFitness = DBL_MAX;
-	const double *lBest = pos;
-	for (int k = 0; k < localK; k++) {
-		const LocalParticle &localP = container[k];
-		const Particle &p = *localP.p;
-		if (p.pBestFitness < minFitness) {
-			minFitness = p.pBestFitness;
-			lBest = p.pBest;
+	int lBestIdx = idx;
+	for (int k = 0; k < num; k++) {
+		const int i = nearest[k].idx;
+		if (pBestFitness[i] < minFitness) {
+			minFitness = pBestFitness[i];
+			lBestIdx   = i;
 		}
 	}
 
-	return lBest;
+	return lBestIdx;
 }
 
-void PsoSolver::setNearNeighborBest(const int idx) {
+template <int Dim>
+void PsoSolver<Dim>::setNearNeighborBest(const int idx) {
+	// bound of stopped evaluation is no fitness for distance ratio, keep last nBest
+	if ( !exactFitness[idx] ) return;
+
 	// current fitness
-	const double fitness = particles[idx].fitness;
-	// current position
-	const double *pos    = particles[idx].pos;
-	// near neighbor best
-	double *nBest = particles[idx].nBest;
+	const double f = fitness[idx];
+	const __m128d signMask = _mm_set1_pd(-0.0);
+	const __m128d fV       = _mm_set1_pd(f);
+	const double *pbf      = &pBestFitness[0];
 
 	double FDR;
 	double maxFDR;
 
-	for (int d = 0; d < dim; d++) { // loop dimension
-		maxFDR = -DBL_MAX;
-		for (int i = 0; i < particleNum; i++) { // loop particle
-			if (i == idx) continue; // skip current particle
-			const Particle &p = particles[i];
+	for (int d = 0; d < Dim; d++) { // loop dimension
+		// current position and pBest row
+		const double  x  = pos[d*stride + idx];
+		const double *pb = pBest + d*stride;
+		const __m128d xV = _mm_set1_pd(x);
+		// near neighbor best
+		double &nb = nBest[d*stride + idx];
+
+		// fitness distance ratio of 2 particles per SIMD vector, first maximum of each lane
+		__m128d maxV = _mm_set1_pd(-DBL_MAX);
+		__m128d argV = _mm_set1_pd(-1.0);
+		__m128d jV   = _mm_set_pd(1.0, 0.0);
+		const __m128d two = _mm_set1_pd(2.0);
+		int j = 0;
+		for (; j+1 < particleNum; j += 2) {
+			__m128d fdr = _mm_div_pd(_mm_sub_pd(fV, _mm_loadu_pd(pbf+j)),
+			                         _mm_andnot_pd(signMask, _mm_sub_pd(xV, _mm_load_pd(pb+j))));
+			// skip current particle
+			if (j == idx)   fdr = _mm_move_sd(fdr, _mm_set1_pd(-DBL_MAX));
+			if (j+1 == idx) fdr = _mm_move_sd(_mm_set1_pd(-DBL_MAX), fdr);
+			const __m128d greater = _mm_cmpgt_pd(fdr, maxV);
+			maxV = _mm_or_pd(_mm_and_pd(greater, fdr), _mm_andnot_pd(greater, maxV));
+			argV = _mm_or_pd(_mm_and_pd(greater, jV),  _mm_andnot_pd(greater, argV));
+			jV   = _mm_add_pd(jV, two);
+		}
+
+		// merge lanes (first maximum on tie), then scalar tail
+		double laneMax[2], laneArg[2];
+		_mm_storeu_pd(laneMax, maxV);
+		_mm_storeu_pd(laneArg, argV);
+		int lane = (laneMax[1] > laneMax[0] || (laneMax[1] == laneMax[0] && laneArg[1] >= 0 && (laneArg[0] < 0 || laneArg[1] < laneArg[0]))) ? 1 : 0;
+		maxFDR = laneMax[lane];
+		int arg = (int) laneArg[lane];
+		for (; j < particleNum; j++) { // loop particle
+			if (j == idx) continue; // skip current particle
 
-			FDR = (fitness - p.pBestFitness) / abs(pos[d] - p.pBest[d]);
+			FDR = (f - pbf[j]) / abs(x - pb[j]);
 
 			if (FDR > maxFDR) {
 				maxFDR = FDR;
-				nBest[d] = p.pBest[d];
+				arg    = j;
 			}
 		}
+
+		if (arg >= 0) nb = pb[arg];
 	}
 }
 
-void PsoSolver::moveParticles() {
-	
-	#pragma omp parallel for
+template <int Dim>
+int PsoSolver<Dim>::getLocalBestScalar(const int idx) const {
+	// squared distance from current pBest to pBest of each particle (current particle last)
+	vector<LocalParticle> container(particleNum);
 	for (int i = 0; i < particleNum; i++) {
-		// velocity weighting
-		double pVecW, gVecW, lVecW, nVecW;
+		LocalParticle &localP = container[i];
+		localP.dist = 0;
+		localP.idx  = i;
+
+		if (i == idx) {
+			localP.dist = DBL_MAX;
+			continue;
+		}
+
+		for (int d = 0; d < Dim; d++) {
+			const double diff = pBest[d*stride + idx] - pBest[d*stride + i];
+			localP.dist += diff*diff;
+		}
+	}
+	sort(container.begin(), container.end(), compareLocalParticle);
+
+	// find the minimum fitness pbest as lbest from localK nearest neighbors
+	double minFitness = DBL_MAX;
+	int lBestIdx = idx;
+	for (int k = 0; k < localK; k++) {
+		const int i = container[k].idx;
+		if (pBestFitness[i] < minFitness) {
+			minFitness = pBestFitness[i];
+			lBestIdx   = i;
+		}
+	}
+
+	return lBestIdx;
+}
+
+template <int Dim>
+void PsoSolver<Dim>::setNearNeighborBestScalar(const int idx) {
+	// bound of stopped evaluation is no fitness for distance ratio, keep last nBest
+	if ( !exactFitness[idx] ) return;
 
-		// current particle
-		Particle &p = particles[i];
+	const double f = fitness[idx];
+	for (int d = 0; d < Dim; d++) {
+		const double  x  = pos[d*stride + idx];
+		const double *pb = pBest + d*stride;
+		double &nb = nBest[d*stride + idx];
 
-		// get random weighting w * [0 ~ 1]
-		// pBest, gBest, lBest, nBest weighting noise
-		pVecW = pw * random();
-        gVecW = gw * random();
+		double maxFDR = -DBL_MAX;
+		for (int i = 0; i < particleNum; i++) {
+			if (i == idx) continue;
 
+			const double FDR = (f - pBestFitness[i]) / abs(x - pb[i]);
+			if (FDR > maxFDR) {
+				maxFDR = FDR;
+				nb = pb[i];
+			}
+		}
+	}
+}
+
+template <int Dim>
+void PsoSolver<Dim>::moveParticles() {
+	// get random weighting w * [0 ~ 1]
+	// pBest, gBest, lBest, nBest weighting noise
+	for (int i = 0; i < particleNum; i++) {
+		RandomStream &rs = streams[i];
+		pVecW[i] = pw * rs.uniform();
+        gVecW[i] = gw * rs.uniform();
 		if (enableGLNPSO) {
-			lVecW = lw * random();
-			nVecW = nw * random();
-			p.lBest = getLocalBest(i);
-			setNearNeighborBest(i);
+			lVecW[i] = lw * rs.uniform();
+			nVecW[i] = nw * rs.uniform();
 		}
-		
-		for (int d = 0; d < dim; d++) {
-			// update velocity
-			if (enableGLNPSO) {
-				p.vec[d] = iw*p.vec[d]                 + 
-					       pVecW*(p.pBest[d]-p.pos[d]) +
-						   gVecW*(gBest[d]-p.pos[d])   + 
-						   lVecW*(p.lBest[d]-p.pos[d]) +
-						   nVecW*(p.nBest[d]-p.pos[d]);
+	}
+
+	if (enableGLNPSO) {
+		// local best and near neighbor best of each particle
+		if (!scalarOnly) {
+			setDistance();
+			localBuffer.resize(particleNum * localK);
+		}
+		#pragma omp parallel for
+		for (int i = 0; i < particleNum; i++) {
+			const int l = scalarOnly ? getLocalBestScalar(i) : getLocalBest(i);
+			for (int d = 0; d < Dim; d++) {
+				lBest[d*stride + i] = pBest[d*stride + l];
+			}
+			if (scalarOnly) {
+				setNearNeighborBestScalar(i);
 			} else {
-				p.vec[d] = iw*p.vec[d]                 + 
-					       pVecW*(p.pBest[d]-p.pos[d]) +
-						   gVecW*(gBest[d]-p.pos[d]);
+				setNearNeighborBest(i);
 			}
+		}
+	}
 
-			// update position
-			p.pos[d] += p.vec[d];
+	// velocity and position update along particles (2 particles per SIMD vector)
+	const __m128d iwV = _mm_set1_pd(iw);
+	for (int d = 0; d < Dim; d++) {
+		double *x        = pos   + d*stride;
+		double *v        = vec   + d*stride;
+		const double *pb = pBest + d*stride;
+		const double *lb = lBest + d*stride;
+		const double *nb = nBest + d*stride;
+		const __m128d g  = _mm_set1_pd(gBest[d]);
+		const __m128d lo = _mm_set1_pd(rangeL[d]);
+		const __m128d hi = _mm_set1_pd(rangeU[d]);
+
+		// rows are padded to SIMD width, the last pair of odd particle number moves one padding lane
+		// (zeroed by reset: no velocity and weighting, position stays clamped in range), no scan reads it back
+		for (int i = 0; i < particleNum; i += 2) {
+			const __m128d xi = _mm_load_pd(x+i);
 
-			// parameter bound check
-            if (p.pos[d] > rangeU[d]) p.pos[d] = rangeU[d];
-            if (p.pos[d] < rangeL[d]) p.pos[d] = rangeL[d];
-		} // end of velocity dimension
+			// update velocity
+			__m128d vi = _mm_mul_pd(iwV, _mm_load_pd(v+i));
+			vi = _mm_add_pd(vi, _mm_mul_pd(_mm_load_pd(pVecW+i), _mm_sub_pd(_mm_load_pd(pb+i), xi)));
+			vi = _mm_add_pd(vi, _mm_mul_pd(_mm_load_pd(gVecW+i), _mm_sub_pd(g, xi)));
+			if (enableGLNPSO) {
+				vi = _mm_add_pd(vi, _mm_mul_pd(_mm_load_pd(lVecW+i), _mm_sub_pd(_mm_load_pd(lb+i), xi)));
+				vi = _mm_add_pd(vi, _mm_mul_pd(_mm_load_pd(nVecW+i), _mm_sub_pd(_mm_load_pd(nb+i), xi)));
+			}
+			_mm_store_pd(v+i, vi);
 
-	} // end of move particles
+			// update position and parameter bound check
+			_mm_store_pd(x+i, _mm_max_pd(_mm_min_pd(_mm_add_pd(xi, vi), hi), lo));
+		} // end of move particles
+	} // end of velocity dimension
 }
 
-bool PsoSolver::setParticle(const double *pos, const double *vec, const int idx) {
-	if (pos == NULL) {
+template <int Dim>
+bool PsoSolver<Dim>::setParticle(const double *pos, const double *vec, const int idx) {
+	if (pos == NULL || idx < 0 || idx >= particleNum) {
 		printf("set particle fail\n");
 		return false;
 	}
 
-	for (int d = 0; d < dim; d++) {
-		particles[idx].pos[d]   = pos[d];
-		particles[idx].pBest[d] = particles[idx].pos[d];
-		if ( vec != NULL) {
-			particles[idx].vec[d] = vec[d];
-		} else {
-			particles[idx].vec[d] = (2.0 * rangeInter[d] * random()) - rangeInter[d];
-		}
+	for (int d = 0; d < Dim; d++) {
+		placedPos[idx*Dim + d] = pos[d];
+		placedVec[idx*Dim + d] = (vec != NULL) ? vec[d] : 0;
 	}
+	placedState[idx] = (vec != NULL) ? 2 : 1;
 
 	return true;
 }
 
-void PsoSolver::run(const bool enableGLNPSO, const double minIw) {
-	this->enableGLNPSO = enableGLNPSO;
-	initFitness();
-	gBest        = particles[0].pBest;
-	gBestFitness = particles[0].pBestFitness;
-	updateGbest();
+template <int Dim>
+void PsoSolver<Dim>::placeParticles() {
+	for (int idx = 0; idx < particleNum; idx++) {
+		if (placedState[idx] == 0) continue;
+
+		for (int d = 0; d < Dim; d++) {
+			const int i = d*stride + idx;
+			this->pos[i] = placedPos[idx*Dim + d];
+			pBest[i]     = pos[i];
+			if (placedState[idx] == 2) {
+				vec[i] = placedVec[idx*Dim + d];
+			} else {
+				vec[i] = (2.0 * rangeInter[d] * streams[idx].uniform()) - rangeInter[d];
+			}
+		}
+	}
+}
+
+template <int Dim>
+void PsoSolver<Dim>::setFitnessBatch(void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj)) {
+	this->getFitnessBatch = getFitnessBatch;
+}
 
-	for (iteration = 0; iteration < maxIteration; iteration++) {
+template <int Dim>
+void PsoSolver<Dim>::setFitnessCache(const double *quantum) {
+	if (quantum == NULL) {
+		cache.disable();
+		return;
+	}
+	// at most one evaluation per particle and iteration
+	cache.setup(Dim, quantum, particleNum*(maxIteration+1));
+}
 
-		if (getDispersionIDX() < convergenceThreshold && getVelocityIDX() < convergenceThreshold) {
-			break;
+template <int Dim>
+int PsoSolver<Dim>::getBestParticles(double *pos, const int num) const {
+	// particle order by pBest fitness (ties by index, partial selection of best num)
+	const int n = min(num, particleNum);
+	vector<pair<double, int>> order(particleNum);
+	for (int i = 0; i < particleNum; i++) {
+		order[i] = pair<double, int>(pBestFitness[i], i);
+	}
+	partial_sort(order.begin(), order.begin() + n, order.end());
+
+	for (int k = 0; k < n; k++) {
+		for (int d = 0; d < Dim; d++) {
+			pos[k*Dim + d] = pBest[d*stride + order[k].second];
 		}
+	}
+	return n;
+}
+
+template <int Dim>
+void PsoSolver<Dim>::begin(const bool enableGLNPSO, const double minIw) {
+	this->enableGLNPSO = enableGLNPSO;
+	this->minIw        = minIw;
+	iteration   = 0;
+	evaluations = 0;
+	initialized = false;
+	stagnation  = 0;
+	stopReason  = STOP_NONE;
+	cache.clear();
+
+	// particles are initialized once per solve
+	initRandomStreams();
+	initParticles();
+	placeParticles();
+
+	// initial particle fitness is exact
+	prepareFitness(false);
+}
 
-		moveParticles();
+template <int Dim>
+bool PsoSolver<Dim>::advance() {
+	commitFitness();
+
+	if (!initialized) {
+		initFitness();
+		gBestFitness = DBL_MAX;
+		updateGbest();
+		initialized = true;
+	} else {
+		const double lastFitness = gBestFitness;
 		updateFitness();
 		updateGbest();
 
+		// equal fitness moves gBest but is no improvement
+		stagnation = (gBestFitness < lastFitness) ? 0 : stagnation + 1;
+
 		// linear interia weighting adjustment
 		iw = max(iw - 1.0/maxIteration, minIw);
-	} // end of iteration
-}
\ No newline at end of file
+		iteration++;
+	}
+
+	stopReason = checkStop();
+	if (stopReason != STOP_NONE) {
+		#pragma omp atomic
+		stopCount[stopReason]++;
+		return false;
+	}
+
+	moveParticles();
+	prepareFitness(true);
+	return true;
+}
+
+template <int Dim>
+void PsoSolver<Dim>::setStopCriteria(const double relativeThreshold, const int stagnationIteration, const int maxEvaluations) {
+	this->relativeThreshold   = relativeThreshold;
+	this->stagnationIteration = stagnationIteration;
+	this->maxEvaluations      = maxEvaluations;
+}
+
+template <int Dim>
+void PsoSolver<Dim>::clearStopCount() {
+	for (int i = 0; i < STOP_REASON_NUM; i++) {
+		stopCount[i] = 0;
+	}
+}
+
+template <int Dim>
+const char* PsoSolver<Dim>::getStopReasonName(const int reason) {
+	switch (reason) {
+	case STOP_MAX_ITERATION: return "max iteration";
+	case STOP_CONVERGENCE:   return "convergence";
+	case STOP_RELATIVE:      return "relative convergence";
+	case STOP_STAGNATION:    return "stagnation";
+	case STOP_BUDGET:        return "evaluation budget";
+	default:                 return "none";
+	}
+}
+
+template <int Dim>
+void PsoSolver<Dim>::run(const bool enableGLNPSO, const double minIw) {
+	begin(enableGLNPSO, minIw);
+	do {
+		evaluate();
+	} while ( advance() );
+}
+
+// instantiated problem dimensions (patch: theta, phi, depth)
+template class PsoSolver<3>;
\ No newline at end of file
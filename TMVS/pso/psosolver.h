@@ -8,7 +8,9 @@
 // include openMP
 #include <omp.h>
 
-#include "particle.h"
+#include "optimizer.h"
+#include "fitnesscache.h"
+#include "randomstream.h"
 
 using namespace std;
 using namespace PAIS;
@@ -16,42 +18,101 @@ using namespace PAIS;
 namespace PAIS {
 	// container for local best
 	struct LocalParticle {
-		// distance from pbest to current position 
-		double dist; 
-		// pbest holder
-		const Particle *p;
+		// distance between pbests
+		double dist;
+		// pbest holder (particle index)
+		int idx;
 	};
 
-	class PsoSolver {
-	private:
-		// sorter for using Local Best
-        static bool sortLocalParticle (const LocalParticle &i, const LocalParticle &j);
+	/*
+		particle swarm optimization (Basic-PSO / GLN-PSO) in Dim dimensions
+
+		particle states are stored as structure of arrays in one aligned block,
+		each state (position, velocity, pBest, nBest, lBest) is Dim rows of
+		particles (state[d*stride + i]), so velocity and position update runs
+		as SIMD loops along particles. Fitness function receives positions of
+		particles (Dim values each).
+	*/
+	template <int Dim>
+	class PsoSolver : public Optimizer<Dim> {
+	public:
+		// termination reason of solve
+		static const int STOP_NONE          = 0; // not terminated
+		static const int STOP_MAX_ITERATION = 1; // max iteration reached
+		static const int STOP_CONVERGENCE   = 2; // absolute DispersionIDX and VelocityIDX under threshold
+		static const int STOP_RELATIVE      = 3; // per dimension dispersion and velocity (ratio of range) under threshold
+		static const int STOP_STAGNATION    = 4; // gBest fitness not improved for stagnation iterations
+		static const int STOP_BUDGET        = 5; // fitness evaluation budget exhausted
+		static const int STOP_REASON_NUM    = 6;
 
-		// dimension of problem space
-		int dim;
+		// initial particle position
+		static const int INIT_RANDOM = 0; // uniform random
+		static const int INIT_HALTON = 1; // randomly shifted Halton sequence (low-discrepancy)
+
+	private:
+		// terminated solves of each reason (all solvers)
+		static long long stopCount[STOP_REASON_NUM];
+		// GLN-PSO neighbor search by full sort and scalar scan (all solvers, verification)
+		static bool scalarOnly;
 
 		// number of iteration
         int iteration;
 
+		// number of fitness evaluation (cache hits excluded)
+		int evaluations;
+
 		// max number of iteration
         int maxIteration;
 
 		// number of particle
 		int particleNum;
+		// row stride of particle states (particle number aligned to SIMD width)
+		int stride;
+		// particle capacity of state block (kept over reset)
+		int capacity;
 
 		// DispersionIDX and VelocityIDX convergence threshold
         double convergenceThreshold;
+		// per dimension convergence threshold (ratio of range, 0: disable)
+		double relativeThreshold;
+		// iterations without gBest improvement to stop (0: disable)
+		int stagnationIteration;
+		// fitness evaluation budget (0: unlimited)
+		int maxEvaluations;
+		// iterations since last gBest fitness improvement
+		int stagnation;
+		// termination reason of last solve
+		int stopReason;
 
-		// particle container
-		vector<Particle> particles;
+		// particle states (Dim * stride each) in one aligned block
+		double *block;
+		double *pos;    // current position
+		double *vec;    // current velocity
+		double *pBest;  // personal best
+		double *nBest;  // near neighbor best (GLN-PSO)
+		double *lBest;  // local best (GLN-PSO)
+		// velocity weighting noise of particles (stride each)
+		double *pVecW;
+		double *gVecW;
+		double *lVecW;
+		double *nVecW;
+		// current and personal best fitness
+		vector<double> fitness;
+		vector<double> pBestFitness;
+		// current fitness is exact (0: bound of stopped evaluation, only above pBest fitness)
+		vector<char> exactFitness;
+		// squared distance between pBests of particles (particleNum * stride)
+		vector<double> distBuffer;
+		// localK nearest neighbors of each particle (particleNum * localK)
+		vector<LocalParticle> localBuffer;
 
 		// upper and lower range
-        double *rangeL;
-        double *rangeU;
-        double *rangeInter; // rangeU - rangeL
-		
+        double rangeL[Dim];
+        double rangeU[Dim];
+        double rangeInter[Dim]; // rangeU - rangeL
+
 		// global best
-        const double *gBest;
+        double gBest[Dim];
         double gBestFitness;
         int    gBestIteration;
 
@@ -61,34 +122,82 @@ namespace PAIS {
         double gw; // gBest weight    (Basic-PSO)
 		double lw; // lBest weight    (GLN-PSO)
 		double nw; // nBest weight    (GLN-PSO)
-	
+
 		// local best K nearest neighbor (GLN-PSO)
 		int localK;
 
 		// flag for using GLN-PSO
 		bool enableGLNPSO;
+		// minimum inertia weight of linear adjustment
+		double minIw;
+		// initial fitness of swarm is set (stepwise run)
+		bool initialized;
 
 		// fitness function
-        double (*getFitness)(const Particle &p, void *obj);
+        double (*getFitness)(const double *pos, void *obj);
+		// batch fitness function (whole swarm per call)
+		void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj);
 		// bundled object for fitness function
 		void *obj;
+		// positions of particles (particle-major) for fitness function
+		vector<double> posBuffer;
+		// fitness of current positions
+		vector<double> fitnessBuffer;
+		// fitness upper bound of each particle (pBest fitness)
+		vector<double> boundBuffer;
+
+		// fitness cache of quantized positions (optional)
+		FitnessCache cache;
+		// pending fitness evaluation is bounded by pBest fitness
+		bool bounded;
+		// particles missed in fitness cache (index, position, bound, fitness)
+		vector<int>           evalIdx;
+		vector<const double*> evalPos;
+		vector<double>        evalBounds;
+		vector<double>        evalFitness;
+
+		// random seed of solver
+		unsigned long long seed;
+		// initial particle position mode (kept over reset)
+		int initMode;
+		// random stream of each particle (keyed by seed and particle index)
+		vector<RandomStream> streams;
+		// particles placed before begin (position, velocity: Dim each, state 0: none, 1: position, 2: position and velocity)
+		vector<double> placedPos;
+		vector<double> placedVec;
+		vector<char>   placedState;
 
-		// set random seed to current time and thread
-		void setRandomSeed() const;
-		// return uniform random number [0, 1]
-        inline double random();
+		// not copyable (owns particle block)
+		PsoSolver(const PsoSolver &solver);
+		PsoSolver& operator=(const PsoSolver &solver);
+
+		// reset random streams of particles from seed
+		void initRandomStreams();
 
 		// PSO convergence index
 		double getDispersionIDX() const;
 		double getVelocityIDX()   const;
+		// per dimension dispersion and velocity (ratio of range) all under relative threshold
+		bool isRelativeConverged() const;
+		// termination reason after update (STOP_NONE: keep moving)
+		int checkStop() const;
 
 		// set initial particle position and velocity
 		void initParticles();
+		// overwrite initialized particles by placed particles (velocity draws follow initial draws)
+		void placeParticles();
+
+		// collect particles to evaluate (cache misses) from current positions (optional: bounded by pBest fitness),
+		// particles over evaluation budget are skipped
+		void prepareFitness(const bool bounded);
+
+		// scatter evaluated fitness into fitness buffer and fitness cache
+		void commitFitness();
 
-		// set initial particle fitness
+		// set initial particle fitness from fitness buffer
 		void initFitness();
 
-		// update particle fitness
+		// update particle fitness from fitness buffer
 		void updateFitness();
 
 		// move particle
@@ -97,25 +206,78 @@ namespace PAIS {
 		// update gbest
 		void updateGbest();
 
-		const double* getLocalBest(const int idx) const;
+		// pairwise pBest distance of all particles (once per iteration)
+		void setDistance();
+
+		// lBest of particle from localK nearest neighbors (partial selection in distance row)
+		int getLocalBest(const int idx);
 
 		void setNearNeighborBest(const int idx);
+
+		// reference neighbor search (sort of whole swarm by pBest distance, scalar fitness distance ratio)
+		int getLocalBestScalar(const int idx) const;
+		void setNearNeighborBestScalar(const int idx);
 	public:
-		PsoSolver(const int dim, 
-			      const double *rangeL, const double *rangeU, 
-				  double (*getFitness)(const Particle &p, void *obj) = NULL, 
+		// unarmed solver (reset before run)
+		PsoSolver(void);
+		PsoSolver(const double *rangeL, const double *rangeU,
+				  double (*getFitness)(const double *pos, void *obj) = NULL,
 				  void *obj = NULL,
 				  int maxIteration = 1000, int particleNum = 30,
-				  double convergenceThreshold = 0.01, 
+				  double convergenceThreshold = 0.01,
 				  double iw = 0.8, double pw = 1.2, double gw = 1.5, double lw = 1.0, double nw = 1.0,
 				  int localK = 5);
 
         ~PsoSolver(void);
 
+		// re-arm solver with new problem, state block is reallocated only for a larger swarm
+		// (fitness batch and cache are disabled, random seed is kept, particles are initialized by begin)
+		void reset(const double *rangeL, const double *rangeU,
+				   double (*getFitness)(const double *pos, void *obj) = NULL,
+				   void *obj = NULL,
+				   int maxIteration = 1000, int particleNum = 30,
+				   double convergenceThreshold = 0.01,
+				   double iw = 0.8, double pw = 1.2, double gw = 1.5, double lw = 1.0, double nw = 1.0,
+				   int localK = 5);
+
+		// set random seed of next begin (same seed, same solve regardless of thread count)
+		void setRandomSeed(const unsigned long long seed);
+		// set initial particle position mode of next begin
+		void setInitMode(const int initMode);
+		// place particle idx at next begin (vec NULL: random velocity)
 		bool setParticle(const double *pos, const double *vec = NULL, const int idx = 0);
+		// set batch fitness function (replace per particle fitness function)
+		// batch fitness may stop a particle once its fitness must exceed bound (pBest fitness),
+		// the returned fitness is then any value above bound. GLN-PSO computes the fitness distance
+		// ratio only for particles of exact fitness, a stopped particle keeps its last nBest
+		void setFitnessBatch(void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj));
+		// enable fitness cache of positions quantized by quantum of each dimension (NULL: disable)
+		void setFitnessCache(const double *quantum);
+		// fitness cache statistics
+		const FitnessCache& getFitnessCache() const { return cache; }
+		// set adaptive stopping (relative threshold: per dimension ratio of range, stagnation: iterations
+		// without gBest improvement, max evaluations: fitness evaluation budget, 0: disable each)
+		void setStopCriteria(const double relativeThreshold, const int stagnationIteration, const int maxEvaluations);
 		void run(const bool enableGLNPSO = false, const double minIw = 0.4);
 
-		int           getDimension()      const { return dim; }
+		// stepwise run (run: begin, then evaluate and advance until advance returns false),
+		// begin initializes particles from random seed, initial mode and placed particles,
+		// swarms of several solvers advance in lockstep when their evaluations are interleaved
+		void begin(const bool enableGLNPSO = false, const double minIw = 0.4);
+		// evaluate fitness of pending particles (thread safe among solvers)
+		void evaluate();
+		// update swarm from evaluated fitness and move particles (false: converged or max iteration)
+		bool advance();
+
+		// pBests of best num particles by fitness (particle-major, best first), returns copied particle number
+		int getBestParticles(double *pos, const int num) const;
+
+		// optimizer interface (initial guess: particle 0, optimize: GLN-PSO)
+		bool setInitialGuess(const double *pos) { return setParticle(pos); }
+		void setMaxEvaluations(const int maxEvaluations) { this->maxEvaluations = maxEvaluations; }
+		void optimize() { run(true); }
+
+		int           getDimension()      const { return Dim; }
 		int           getParticleNum()    const { return particleNum; }
         int           getMaxIteration()   const { return maxIteration; }
         double        getInertiaWeight()  const { return iw; }
@@ -129,6 +291,19 @@ namespace PAIS {
 		double        getGbestFitness()   const { return gBestFitness; }
         int           getGbestIteration() const { return gBestIteration; }
 		int           getIteration()      const { return iteration; }
+		int           getEvaluations()    const { return evaluations; }
+		unsigned long long getRandomSeed() const { return seed; }
+		int           getInitMode()       const { return initMode; }
+		int           getStopReason()     const { return stopReason; }
+
+		// terminated solve counter of reason (all solvers since last clear)
+		static long long getStopCount(const int reason) { return stopCount[reason]; }
+		static void clearStopCount();
+		// name of termination reason
+		static const char* getStopReasonName(const int reason);
+		// force reference neighbor search of GLN-PSO (for verification, same seed gives same solve)
+		static void setScalarOnly(const bool scalarOnly) { PsoSolver::scalarOnly = scalarOnly; }
+		static bool isScalarOnly() { return scalarOnly; }
 	};
 };
 
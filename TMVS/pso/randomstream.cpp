@@ -0,0 +1,19 @@
+#include "randomstream.h"
+
+using namespace PAIS;
+
+RandomStream::RandomStream(const unsigned long long seed, const unsigned long long stream) {
+	setKey(seed, stream);
+}
+
+void RandomStream::setKey(const unsigned long long seed, const unsigned long long stream) {
+	// decorrelate neighboring seeds and stream ids
+	key     = mix(mix(seed) ^ (stream*0xD1B54A32D192ED03ULL + 0x9E3779B97F4A7C15ULL));
+	counter = 0;
+}
+
+void RandomStream::uniform(double *u, const int n) {
+	for (int i = 0; i < n; i++) {
+		u[i] = uniform();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef __PAIS_RANDOM_STREAM_H__
+#define __PAIS_RANDOM_STREAM_H__
+
+namespace PAIS {
+	/*
+		counter-based random number stream (SplitMix64 style)
+
+		the n-th number of a stream is a hash of (key, n), no state is shared
+		between streams. A stream per particle keyed by (seed, particle index)
+		gives the same sequence regardless of thread count and scheduling.
+	*/
+	class RandomStream {
+	private:
+		// stream key from seed and stream id
+		unsigned long long key;
+		// number of drawn values
+		unsigned long long counter;
+
+		// SplitMix64 finalizer
+		static unsigned long long mix(unsigned long long z);
+
+	public:
+		RandomStream(const unsigned long long seed = 0, const unsigned long long stream = 0);
+
+		// reset stream to counter 0 of (seed, stream)
+		void setKey(const unsigned long long seed, const unsigned long long stream);
+		unsigned long long getCounter() const { return counter; }
+
+		// return uniform random number [0, 1)
+		inline double uniform() {
+			// 53 random bits as double mantissa
+			return (double) (mix(key + (++counter)*0x9E3779B97F4A7C15ULL) >> 11) * (1.0 / 9007199254740992.0);
+		}
+		// fill n uniform random numbers [0, 1)
+		void uniform(double *u, const int n);
+	};
+
+	inline unsigned long long RandomStream::mix(unsigned long long z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+#include "simplexsolver.h"
+
+using namespace std;
+using namespace PAIS;
+
+template <int Dim> const double SimplexSolver<Dim>::ALPHA = 1.0;
+template <int Dim> const double SimplexSolver<Dim>::GAMMA = 2.0;
+template <int Dim> const double SimplexSolver<Dim>::RHO   = 0.5;
+template <int Dim> const double SimplexSolver<Dim>::SIGMA = 0.5;
+
+template <int Dim>
+SimplexSolver<Dim>::SimplexSolver(void) {
+	const double zero[Dim] = {0};
+	reset(zero, zero);
+}
+
+template <int Dim>
+void SimplexSolver<Dim>::reset(const double *rangeL, const double *rangeU,
+				   double (*getFitness)(const double *pos, void *obj),
+				   void *obj,
+				   int maxIteration, double initialStep,
+				   double convergenceThreshold) {
+	this->getFitness           = getFitness;
+	this->getFitnessBatch      = NULL;
+	this->obj                  = obj;
+	this->maxIteration         = maxIteration;
+	this->initialStep          = initialStep;
+	this->convergenceThreshold = convergenceThreshold;
+	this->iteration            = 0;
+	this->evaluations          = 0;
+	this->maxEvaluations       = 0;
+
+	for (int d = 0; d < Dim; d++) {
+		this->rangeL[d]     = rangeL[d];
+		this->rangeU[d]     = rangeU[d];
+		this->rangeInter[d] = rangeU[d] - rangeL[d];
+		this->init[d]       = rangeL[d] + 0.5*rangeInter[d];
+	}
+
+	for (int k = 0; k <= Dim; k++) {
+		for (int d = 0; d < Dim; d++) {
+			vertex[k][d] = init[d];
+		}
+		fitness[k] = DBL_MAX;
+	}
+}
+
+template <int Dim>
+void SimplexSolver<Dim>::setFitnessBatch(void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj)) {
+	this->getFitnessBatch = getFitnessBatch;
+}
+
+template <int Dim>
+bool SimplexSolver<Dim>::setInitialGuess(const double *pos) {
+	if (pos == NULL) {
+		printf("set initial guess fail\n");
+		return false;
+	}
+	for (int d = 0; d < Dim; d++) {
+		init[d] = pos[d];
+	}
+	clamp(init);
+	return true;
+}
+
+template <int Dim>
+void SimplexSolver<Dim>::evaluate(const double * const *pos, const int num, const double *bounds, double *fitness) {
+	evaluations += num;
+	if (getFitnessBatch != NULL) {
+		getFitnessBatch(pos, num, bounds, fitness, obj);
+	} else {
+		for (int n = 0; n < num; n++) {
+			fitness[n] = getFitness(pos[n], obj);
+		}
+	}
+}
+
+template <int Dim>
+double SimplexSolver<Dim>::evaluate(const double *pos, const double bound) {
+	double f;
+	evaluate(&pos, 1, &bound, &f);
+	return f;
+}
+
+template <int Dim>
+void SimplexSolver<Dim>::clamp(double *pos) const {
+	for (int d = 0; d < Dim; d++) {
+		if (pos[d] > rangeU[d]) pos[d] = rangeU[d];
+		if (pos[d] < rangeL[d]) pos[d] = rangeL[d];
+	}
+}
+
+template <int Dim>
+void SimplexSolver<Dim>::sortVertices() {
+	// insertion sort (Dim+1 vertices)
+	for (int k = 1; k <= Dim; k++) {
+		for (int j = k; j > 0 && fitness[j] < fitness[j-1]; j--) {
+			swap(fitness[j], fitness[j-1]);
+			for (int d = 0; d < Dim; d++) {
+				swap(vertex[j][d], vertex[j-1][d]);
+			}
+		}
+	}
+}
+
+template <int Dim>
+double SimplexSolver<Dim>::getDispersionIDX() const {
+	double index = 0;
+	for (int k = 1; k <= Dim; k++) {
+		for (int d = 0; d < Dim; d++) {
+			index += abs(vertex[k][d] - vertex[0][d]);
+		}
+	}
+	index /= (Dim*Dim);
+	return index;
+}
+
+template <int Dim>
+void SimplexSolver<Dim>::optimize() {
+	iteration   = 0;
+	evaluations = 0;
+
+	// initial simplex: initial guess and a step along each dimension (inward at upper bound)
+	const double *pos[Dim+1];
+	for (int k = 0; k <= Dim; k++) {
+		for (int d = 0; d < Dim; d++) {
+			vertex[k][d] = init[d];
+		}
+		if (k > 0) {
+			const int d = k-1;
+			const double step = initialStep * rangeInter[d];
+			vertex[k][d] += (vertex[k][d] + step <= rangeU[d]) ? step : -step;
+			clamp(vertex[k]);
+		}
+		pos[k] = vertex[k];
+		fitness[k] = DBL_MAX;
+	}
+
+	// budget below initial simplex: initial guess only
+	if ( !canEvaluate(Dim+1) ) {
+		if ( canEvaluate(1) ) fitness[0] = evaluate(vertex[0], DBL_MAX);
+		return;
+	}
+	evaluate(pos, Dim+1, NULL, fitness);
+	sortVertices();
+
+	double centroid[Dim];
+	double reflect[Dim], expand[Dim], contract[Dim];
+	for (iteration = 0; iteration < maxIteration; iteration++) {
+
+		if (getDispersionIDX() < convergenceThreshold || !canEvaluate(1)) {
+			break;
+		}
+
+		// centroid of all vertices but the worst
+		for (int d = 0; d < Dim; d++) {
+			centroid[d] = 0;
+			for (int k = 0; k < Dim; k++) {
+				centroid[d] += vertex[k][d];
+			}
+			centroid[d] /= Dim;
+		}
+		double *worst = vertex[Dim];
+
+		// reflection (must beat worst)
+		for (int d = 0; d < Dim; d++) {
+			reflect[d] = centroid[d] + ALPHA*(centroid[d] - worst[d]);
+		}
+		clamp(reflect);
+		const double fr = evaluate(reflect, fitness[Dim]);
+
+		if (fr < fitness[0]) {
+			// expansion (must beat reflection, reflection is accepted out of budget)
+			double fe = DBL_MAX;
+			if ( canEvaluate(1) ) {
+				for (int d = 0; d < Dim; d++) {
+					expand[d] = centroid[d] + GAMMA*(reflect[d] - centroid[d]);
+				}
+				clamp(expand);
+				fe = evaluate(expand, fr);
+			}
+			const bool useExpand = (fe < fr);
+			for (int d = 0; d < Dim; d++) {
+				worst[d] = useExpand ? expand[d] : reflect[d];
+			}
+			fitness[Dim] = useExpand ? fe : fr;
+		} else if (fr < fitness[Dim-1]) {
+			// accept reflection
+			for (int d = 0; d < Dim; d++) {
+				worst[d] = reflect[d];
+			}
+			fitness[Dim] = fr;
+		} else {
+			if ( !canEvaluate(1) ) break;
+
+			// contraction outside (reflection beats worst) or inside (must beat both)
+			const bool outside = (fr < fitness[Dim]);
+			const double bound = outside ? fr : fitness[Dim];
+			for (int d = 0; d < Dim; d++) {
+				contract[d] = centroid[d] + RHO*((outside ? reflect[d] : worst[d]) - centroid[d]);
+			}
+			const double fc = evaluate(contract, bound);
+
+			if (fc < bound) {
+				for (int d = 0; d < Dim; d++) {
+					worst[d] = contract[d];
+				}
+				fitness[Dim] = fc;
+			} else {
+				if ( !canEvaluate(Dim) ) break;
+
+				// shrink toward best vertex
+				for (int k = 1; k <= Dim; k++) {
+					for (int d = 0; d < Dim; d++) {
+						vertex[k][d] = vertex[0][d] + SIGMA*(vertex[k][d] - vertex[0][d]);
+					}
+				}
+				evaluate(pos+1, Dim, NULL, fitness+1);
+			}
+		}
+
+		sortVertices();
+	} // end of iteration
+}
+
+// instantiated problem dimensions (patch: theta, phi, depth)
+template class SimplexSolver<3>;
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef __PAIS_SIMPLEX_SOLVER_H__
+#define __PAIS_SIMPLEX_SOLVER_H__
+
+#include <stdlib.h>
+
+#include "optimizer.h"
+
+namespace PAIS {
+	/*
+		Nelder-Mead simplex local minimizer in Dim dimensions
+
+		starts from a simplex around the initial guess (step: ratio of search
+		range), vertices are clamped into range. Reflection, expansion and
+		contraction are evaluated under the fitness which they must beat, so
+		batch fitness can stop early on rejected trial points. Out of evaluation
+		budget, expansion is skipped and the search stops before contraction.
+	*/
+	template <int Dim>
+	class SimplexSolver : public Optimizer<Dim> {
+	private:
+		// reflection, expansion, contraction and shrink coefficients
+		static const double ALPHA;
+		static const double GAMMA;
+		static const double RHO;
+		static const double SIGMA;
+
+		// number of iteration
+		int iteration;
+		// max number of iteration
+		int maxIteration;
+		// number of fitness evaluation
+		int evaluations;
+		// fitness evaluation budget (0: unlimited)
+		int maxEvaluations;
+
+		// initial simplex step (ratio of search range)
+		double initialStep;
+		// simplex dispersion convergence threshold
+		double convergenceThreshold;
+
+		// upper and lower range
+		double rangeL[Dim];
+		double rangeU[Dim];
+		double rangeInter[Dim]; // rangeU - rangeL
+
+		// simplex vertices sorted by fitness (0: best)
+		double vertex[Dim+1][Dim];
+		double fitness[Dim+1];
+		// initial guess
+		double init[Dim];
+
+		// fitness function
+		double (*getFitness)(const double *pos, void *obj);
+		// batch fitness function
+		void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj);
+		// bundled object for fitness function
+		void *obj;
+
+		// fitness of points (bounds: NULL for exact fitness)
+		void evaluate(const double * const *pos, const int num, const double *bounds, double *fitness);
+		// fitness of single point under bound
+		double evaluate(const double *pos, const double bound);
+		// num more evaluations are in budget
+		bool canEvaluate(const int num) const { return maxEvaluations <= 0 || evaluations + num <= maxEvaluations; }
+		// clamp point into range
+		void clamp(double *pos) const;
+		// sort vertices by fitness
+		void sortVertices();
+		// simplex convergence index (mean distance to best vertex)
+		double getDispersionIDX() const;
+
+	public:
+		SimplexSolver(void);
+
+		// re-arm solver with new problem (initial guess: center of range)
+		void reset(const double *rangeL, const double *rangeU,
+				   double (*getFitness)(const double *pos, void *obj) = NULL,
+				   void *obj = NULL,
+				   int maxIteration = 200, double initialStep = 0.1,
+				   double convergenceThreshold = 0.01);
+
+		// optimizer interface
+		void setFitnessBatch(void (*getFitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj));
+		bool setInitialGuess(const double *pos);
+		void setMaxEvaluations(const int maxEvaluations) { this->maxEvaluations = maxEvaluations; }
+		void optimize();
+
+		int           getDimension()      const { return Dim; }
+		int           getMaxIteration()   const { return maxIteration; }
+		const double* getGbest()          const { return vertex[0]; }
+		double        getGbestFitness()   const { return fitness[0]; }
+		int           getIteration()      const { return iteration; }
+		int           getEvaluations()    const { return evaluations; }
+	};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "solverpool.h"
+
+using namespace PAIS;
+
+template <int Dim>
+PAIS_THREAD_LOCAL SolverPool<Dim>* SolverPool<Dim>::threadPool = NULL;
+
+template <int Dim>
+SolverPool<Dim>::~SolverPool(void) {
+	for (size_t i = 0; i < solvers.size(); ++i) {
+		delete solvers[i];
+	}
+}
+
+template <int Dim>
+SolverPool<Dim>& SolverPool<Dim>::getThreadPool() {
+	// pool lives as long as the thread (openMP threads are pooled)
+	if (threadPool == NULL) {
+		threadPool = new SolverPool();
+	}
+	return *threadPool;
+}
+
+template <int Dim>
+PsoSolver<Dim>* SolverPool<Dim>::acquire() {
+	SolverPool &pool = getThreadPool();
+	if (pool.solvers.empty()) {
+		return new PsoSolver<Dim>();
+	}
+	PsoSolver<Dim> *solver = pool.solvers.back();
+	pool.solvers.pop_back();
+	return solver;
+}
+
+template <int Dim>
+void SolverPool<Dim>::release(PsoSolver<Dim> *solver) {
+	if (solver == NULL) return;
+	getThreadPool().solvers.push_back(solver);
+}
+
+// instantiated problem dimensions (patch: theta, phi, depth)
+template class SolverPool<3>;
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef __PAIS_SOLVER_POOL_H__
+#define __PAIS_SOLVER_POOL_H__
+
+#include <vector>
+
+#include "psosolver.h"
+#include "../mvs/utility.h"
+
+using namespace std;
+
+namespace PAIS {
+	/*
+		per-thread pool of idle PSO solvers
+
+		a solver is borrowed for one optimization and re-armed by reset(),
+		its particle block and buffers are kept, so solver lifecycle of
+		patch refinement does not touch the heap once the pool is warm.
+	*/
+	template <int Dim>
+	class SolverPool {
+	private:
+		// idle solvers of this thread
+		vector<PsoSolver<Dim>*> solvers;
+
+		static PAIS_THREAD_LOCAL SolverPool *threadPool;
+
+		SolverPool(void) {}
+		~SolverPool(void);
+
+		// pool of calling thread
+		static SolverPool& getThreadPool();
+
+	public:
+		// borrow an idle solver of calling thread (reset before run)
+		static PsoSolver<Dim>* acquire();
+		// return solver to pool of calling thread
+		static void release(PsoSolver<Dim> *solver);
+	};
+
+	// solver borrowed from thread pool, returned at end of scope
+	template <int Dim>
+	class PooledSolver {
+	private:
+		PsoSolver<Dim> *solver;
+
+		PooledSolver(const PooledSolver &);
+		PooledSolver& operator=(const PooledSolver &);
+
+	public:
+		PooledSolver(void) : solver(SolverPool<Dim>::acquire()) {}
+		~PooledSolver(void) { SolverPool<Dim>::release(solver); }
+
+		PsoSolver<Dim>* operator->() const { return solver; }
+		PsoSolver<Dim>& operator*()  const { return *solver; }
+	};
+};
+
+#endif
\ No newline at end of file
@@ -216,16 +216,16 @@ void MvsViewer::addPatch(const Patch &pth) {
 }
 
 void MvsViewer::addPatches() {
-	const map<int, Patch> &patches = mvs->getPatches();
-	map<int, Patch>::const_iterator it;
+	const PatchMap &patches = mvs->getPatches();
+	PatchMap::const_iterator it;
 
 	for (it = patches.begin(); it != patches.end(); ++it) {
 		// patch center
-		const Vec3d &p = it->second.getCenter();
+		const Vec3d &p = it->getCenter();
 		// patch normal
-		const Vec3d &n = it->second.getNormal();
+		const Vec3d &n = it->getNormal();
 		// patch color
-		const Vec3b &c = it->second.getColor();
+		const Vec3b &c = it->getColor();
 		
 		PointXYZRGB pt;
 		pt.x = p[0];
@@ -256,11 +256,11 @@ void MvsViewer::addPatches() {
 }
 
 void MvsViewer::addPatchesAnimate() {
-	const map<int, Patch> &patches = mvs->getPatches();
+	const PatchMap &patches = mvs->getPatches();
 	const int pthNum = (int) mvs->getPatches().size();
-	map<int, Patch>::const_iterator it;
+	PatchMap::const_iterator it;
 	for (it = patches.begin(); it != patches.end(); ++it) {
-		addPatch(it->second);
+		addPatch(*it);
 	}
 }
 
@@ -361,11 +361,11 @@ const Patch* MvsViewer::getPickedPatch(const int idx) const {
 		return NULL;
 	}
 
-	map<int, Patch>::const_iterator it;
+	PatchMap::const_iterator it;
 	it = mvs->getPatches().begin();
 	for (int i = 0; i < idx; ++it, ++i);
 
-	return &it->second;
+	return &*it;
 }
 
 void MvsViewer::showPickedPoint(const Patch &pth) {
@@ -0,0 +1,291 @@
+#include <time.h>
+
+#include <opencv2\opencv.hpp>
+
+#include "../TMVS/io/logmanager.h"
+#include "../TMVS/mvs/mvs.h"
+#include "../TMVS/mvs/patch.h"
+#include "../TMVS/config.h"
+
+using namespace cv;
+using namespace PAIS;
+
+MvsConfig config;
+
+// no viewer in checks
+void addPatchView(const Patch &pth) {
+}
+
+// batch fitness without evaluation bound (reference of bounded evaluation)
+void getExactFitnessBatch(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj) {
+	getFitnessBatch(pos, num, NULL, fitness, obj);
+}
+
+// arm seeded solver on loaded patch (search range of seed patch refinement)
+void setCheckSolver(PsoSolver<3> &solver, const Patch &pth, void (*fitnessBatch)(const double * const *pos, const int num, const double *bounds, double *fitness, void *obj)) {
+	const Vec2d &normalS = pth.getSphericalNormal();
+	const double rangeL[] = {0.0,   normalS[1] - CV_PI/2.0, pth.getDepthRange()[0]};
+	const double rangeU[] = {CV_PI, normalS[1] + CV_PI/2.0, pth.getDepthRange()[1]};
+	const double init[]   = {normalS[0], normalS[1], pth.getDepth()};
+
+	solver.reset(rangeL, rangeU, getFitness, (void *) &pth, config.maxIteration, config.particleNum);
+	solver.setRandomSeed( ((unsigned long long) (unsigned int) config.randomSeed << 32) | (unsigned int) pth.getId() );
+	solver.setFitnessBatch(fitnessBatch);
+	solver.setInitialGuess(init);
+}
+
+// smooth multimodal fitness of swarm benchmark
+double getCheckFitness(const double *pos, void *obj) {
+	double f = 0;
+	for (int d = 0; d < 3; ++d) {
+		const double x = pos[d] - 0.3*d;
+		f += x*x + 0.1*sin(10.0*pos[d]);
+	}
+	return f;
+}
+
+// plane of patch parameter (theta, phi, depth) and its derivatives of each parameter (as Gauss-Newton linearization)
+void getCheckPlane(const Patch &pth, const Vec3d &refCenter, const double *p, Vec3d &center, Vec3d &normal, Vec3d *dCenter, Vec3d *dNormal) {
+	const double st = sin(p[0]), ct = cos(p[0]);
+	const double sp = sin(p[1]), cp = cos(p[1]);
+	normal = Vec3d(st*cp, st*sp, ct);
+	center = pth.getRay() * p[2] + refCenter;
+	dNormal[0] = Vec3d(ct*cp, ct*sp, -st);
+	dNormal[1] = Vec3d(-st*sp, st*cp, 0.0);
+	dNormal[2] = Vec3d(0.0, 0.0, 0.0);
+	dCenter[0] = Vec3d(0.0, 0.0, 0.0);
+	dCenter[1] = Vec3d(0.0, 0.0, 0.0);
+	dCenter[2] = pth.getRay();
+}
+
+// max absolute entry of matrix
+double getMaxAbs(const Matx33d &m) {
+	double maxAbs = 0;
+	for (int j = 0; j < 9; ++j) {
+		maxAbs = max(maxAbs, abs(m.val[j]));
+	}
+	return maxAbs;
+}
+
+// same gBest and gBest fitness (bitwise)
+bool isSameSolution(const Optimizer<3> &a, const Optimizer<3> &b) {
+	if (a.getGbestFitness() != b.getGbestFitness()) return false;
+	for (int d = 0; d < 3; ++d) {
+		if (a.getGbest()[d] != b.getGbest()[d]) return false;
+	}
+	return true;
+}
+
+// bounded fitness: seeded Basic-PSO swarms with and without evaluation bound reach the same gBest,
+// GLN-PSO keeps the last nBest of stopped particles (report gBest fitness and warped pixels)
+void checkBoundedFitness(const PatchMap &patches) {
+	const char *psoNames[] = {"basic-pso", "gln-pso"};
+	PsoSolver<3> bounded, exact;
+	int swarmNum, mismatch;
+	double boundedFit, exactFit;
+	long long boundedPixels, exactPixels;
+	clock_t boundedTime, exactTime, start_t;
+	for (int gln = 0; gln < 2; ++gln) {
+		swarmNum = mismatch = 0;
+		boundedFit = exactFit = 0;
+		boundedPixels = exactPixels = 0;
+		boundedTime = exactTime = 0;
+		for (PatchMap::const_iterator it = patches.begin(); it != patches.end(); ++it) {
+			setCheckSolver(bounded, *it, getFitnessBatch);
+			setCheckSolver(exact,   *it, getExactFitnessBatch);
+
+			FitnessKernel::clearPixelCount();
+			start_t = clock();
+			bounded.run(gln == 1);
+			boundedTime   += clock() - start_t;
+			boundedPixels += FitnessKernel::getPixelCount();
+
+			FitnessKernel::clearPixelCount();
+			start_t = clock();
+			exact.run(gln == 1);
+			exactTime   += clock() - start_t;
+			exactPixels += FitnessKernel::getPixelCount();
+
+			boundedFit += bounded.getGbestFitness();
+			exactFit   += exact.getGbestFitness();
+			if ( !isSameSolution(bounded, exact) ) ++mismatch;
+			++swarmNum;
+		}
+		FitnessKernel::clearPixelCount();
+		boundedFit /= swarmNum;
+		exactFit   /= swarmNum;
+
+		printf("bounded fitness %s:\t%d / %d swarms differ\tmean gBest fitness: %f (exact %f)\n", psoNames[gln], mismatch, swarmNum, boundedFit, exactFit);
+		printf("bounded fitness %s:\tpixels: %lld (exact %lld)\ttime: %f (exact %f)\n", psoNames[gln], boundedPixels, exactPixels, (double) boundedTime / CLOCKS_PER_SEC, (double) exactTime / CLOCKS_PER_SEC);
+		LogManager::log("check bounded fitness %s swarms: %d differ: %d mean fitness: %f (exact %f) pixels: %lld (exact %lld) time: %f (exact %f)",
+			psoNames[gln], swarmNum, mismatch, boundedFit, exactFit, boundedPixels, exactPixels, (double) boundedTime / CLOCKS_PER_SEC, (double) exactTime / CLOCKS_PER_SEC);
+	}
+}
+
+// GLN-PSO neighbor search: SIMD search and reference search (full sort, scalar scan) reach the same gBest,
+// and neighbor search time of growing swarm in one thread
+void checkNeighborSearch(const PatchMap &patches) {
+	PsoSolver<3> simd, reference;
+	clock_t start_t;
+	int mismatch = 0;
+	for (PatchMap::const_iterator it = patches.begin(); it != patches.end(); ++it) {
+		PsoSolver<3>::setScalarOnly(false);
+		setCheckSolver(simd, *it, getFitnessBatch);
+		simd.run(true);
+
+		PsoSolver<3>::setScalarOnly(true);
+		setCheckSolver(reference, *it, getFitnessBatch);
+		reference.run(true);
+
+		if ( !isSameSolution(simd, reference) ) ++mismatch;
+	}
+	printf("neighbor search:\t%d / %d patches differ\n", mismatch, patches.size());
+	LogManager::log("check neighbor search patches: %d differ: %d", patches.size(), mismatch);
+
+	// neighbor search time of growing swarm in one thread (synthetic fitness, no convergence stop)
+	const int threads = omp_get_max_threads();
+	omp_set_num_threads(1);
+	const double rangeL[] = {-1.0, -1.0, -1.0};
+	const double rangeU[] = { 2.0,  2.0,  2.0};
+	const int sizes[] = {30, 60, 200};
+	for (int s = 0; s < 3; ++s) {
+		clock_t time[2] = {0, 0};
+		mismatch = 0;
+		for (int seed = 0; seed < 10; ++seed) {
+			for (int m = 0; m < 2; ++m) {
+				PsoSolver<3> &solver = (m == 0) ? simd : reference;
+				PsoSolver<3>::setScalarOnly(m == 1);
+				solver.reset(rangeL, rangeU, getCheckFitness, NULL, 100, sizes[s], 0.0);
+				solver.setRandomSeed(seed);
+
+				start_t = clock();
+				solver.run(true);
+				time[m] += clock() - start_t;
+			}
+			if ( !isSameSolution(simd, reference) ) ++mismatch;
+		}
+		const double simdSec   = (double) time[0] / CLOCKS_PER_SEC;
+		const double scalarSec = (double) time[1] / CLOCKS_PER_SEC;
+		printf("neighbor search N=%d:\t%d / 10 swarms differ\tsimd %f\treference %f\tspeedup %f\n", sizes[s], mismatch, simdSec, scalarSec, (simdSec > 0) ? scalarSec / simdSec : 0.0);
+		LogManager::log("check neighbor search particles: %d differ: %d simd: %f reference: %f", sizes[s], mismatch, simdSec, scalarSec);
+	}
+	PsoSolver<3>::setScalarOnly(false);
+	omp_set_num_threads(threads);
+}
+
+// warp kernel: AVX2 and scalar kernel fitness of each patch within tolerance
+void checkWarpKernel(const PatchMap &patches) {
+	if ( !WarpKernel::isAVX2Supported() ) {
+		printf("warp kernel:\tno AVX2, skipped\n");
+		return;
+	}
+
+	const double tolerance = 1e-9;
+	double p[3];
+	double maxDiff = 0;
+	int count = 0;
+	int mismatch = 0;
+	for (PatchMap::const_iterator it = patches.begin(); it != patches.end(); ++it) {
+		const Patch &pth = *it;
+		p[0] = pth.getSphericalNormal()[0];
+		p[1] = pth.getSphericalNormal()[1];
+		p[2] = pth.getDepth();
+
+		WarpKernel::setScalarOnly(true);
+		const double fitScalar = getFitness(p, (void *) &pth, false);
+		WarpKernel::setScalarOnly(false);
+		const double fitAVX2   = getFitness(p, (void *) &pth, false);
+		++count;
+
+		// both kernels mark the same out of image sample
+		if (fitScalar == DBL_MAX || fitAVX2 == DBL_MAX) {
+			if (fitScalar != fitAVX2) ++mismatch;
+			continue;
+		}
+		const double diff = abs(fitScalar - fitAVX2);
+		maxDiff = max(maxDiff, diff);
+		if (diff > tolerance) ++mismatch;
+	}
+	printf("warp kernel:\t%d / %d patches over tolerance %e (max abs diff %e)\n", mismatch, count, tolerance, maxDiff);
+	LogManager::log("check warp kernel patches: %d over tolerance: %d max abs diff: %e", count, mismatch, maxDiff);
+}
+
+// homography derivative: analytic derivative of (theta, phi, depth) against central differences,
+// error relative to max entry of homography
+void checkHomographyDerivative(const MVS &mvs, const PatchMap &patches) {
+	const double derivativeTolerance = 1e-9;
+	HomographyEngine engine;
+	vector<Matx33d> H, dH, plusH, minusH;
+	Vec3d center, normal, dCenter[3], dNormal[3];
+	double maxRelDiff = 0;
+	int mismatch = 0;
+	for (PatchMap::const_iterator it = patches.begin(); it != patches.end(); ++it) {
+		const Patch &pth = *it;
+		const int camNum = pth.getCameraNumber();
+		const Vec3d &refCenter = mvs.getCamera(pth.getReferenceCameraIndex()).getCenter();
+		engine.setup(mvs.getCameras(), pth.getReferenceCameraIndex(), pth.getCameraIndices(), pow(mvs.getLODRatio(), pth.getLOD()));
+		H.resize(camNum);
+		dH.resize(camNum*3);
+		plusH.resize(camNum);
+		minusH.resize(camNum);
+
+		const double p[] = {pth.getSphericalNormal()[0], pth.getSphericalNormal()[1], pth.getDepth()};
+		getCheckPlane(pth, refCenter, p, center, normal, dCenter, dNormal);
+		engine.getHomographyDerivatives(center, normal, dCenter, dNormal, 3, &H[0], &dH[0]);
+
+		double patchDiff = 0;
+		for (int k = 0; k < 3; ++k) {
+			const double step = 1e-6 * max(1.0, abs(p[k]));
+			double q[] = {p[0], p[1], p[2]};
+			q[k] = p[k] + step;
+			getCheckPlane(pth, refCenter, q, center, normal, dCenter, dNormal);
+			engine.getHomographies(center, normal, &plusH[0]);
+			q[k] = p[k] - step;
+			getCheckPlane(pth, refCenter, q, center, normal, dCenter, dNormal);
+			engine.getHomographies(center, normal, &minusH[0]);
+
+			for (int i = 0; i < camNum; ++i) {
+				const Matx33d numeric = (plusH[i] - minusH[i]) * (0.5 / step);
+				patchDiff = max(patchDiff, getMaxAbs(numeric - dH[i*3 + k]) / max(getMaxAbs(H[i]), DBL_MIN));
+			}
+		}
+		maxRelDiff = max(maxRelDiff, patchDiff);
+		if (patchDiff > derivativeTolerance) ++mismatch;
+	}
+	engine.clear();
+	printf("homography derivative:\t%d / %d patches over tolerance %e (max rel diff %e)\n", mismatch, patches.size(), derivativeTolerance, maxRelDiff);
+	LogManager::log("check homography derivative patches: %d over tolerance: %d max rel diff: %e", patches.size(), mismatch, maxRelDiff);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		printf("[filename.mvs]: numerical checks (bounded fitness, neighbor search, warp kernel, homography derivative)\n");
+		return 1;
+	}
+
+	// MVS configures
+	setInitConfig(config);
+	FileLoader::loadConfig(CONFIG_FILE_NAME, config);
+
+	// set MVS instance
+	MVS &mvs = MVS::getInstance(config);
+	mvs.loadMVS(argv[1]);
+	mvs.setConfig(config);
+
+	const PatchMap &patches = mvs.getPatches();
+	if ( patches.empty() ) {
+		printf("no patch\n");
+		return 1;
+	}
+
+	checkBoundedFitness(patches);
+	checkNeighborSearch(patches);
+	checkWarpKernel(patches);
+	checkHomographyDerivative(mvs, patches);
+
+	// close log file
+	LogManager::close();
+
+	return 0;
+}
\ No newline at end of file